@@ -0,0 +1,309 @@
+#pragma once
+
+// Arena and size-class pool memory resources with allocation accounting.
+//
+// Both are std::pmr::memory_resource, so std::pmr containers and
+// HugePageArray (huge_pages.h) allocate from them directly:
+//
+//   ArenaResource  - monotonic: bump allocation out of large chunks,
+//                    deallocate() only updates the accounting. reset()
+//                    rewinds every chunk for the next benchmark run without
+//                    returning memory, so repeated runs never page-fault
+//                    again. Chunks are HugePageArray mappings (2 MB pages)
+//                    and are not touched here, so a consumer's parallel
+//                    first touch still places the pages.
+//   PoolResource   - free lists per power-of-two size class (16 B - 64 KB)
+//                    on top of an upstream resource (normally an arena), so
+//                    short-lived small blocks are recycled instead of bumped.
+//                    Larger blocks are kept on a free list by size and reused
+//                    for requests that fit, which covers the usual
+//                    allocate-run-free benchmark loop.
+//
+// Accounting counts the bytes callers asked for (peak of live bytes is what
+// a kernel actually needed) separately from the bytes reserved from the
+// layer below (what it cost). An ArenaResource with a budget throws
+// std::bad_alloc instead of reserving past it, so a set of kernels can be
+// checked against a fixed memory limit. Neither resource is thread-safe;
+// allocate outside parallel regions. ScopedDefaultResource routes every
+// std::pmr allocation that names no resource into one for a scope.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "huge_pages.h"
+
+namespace hpc {
+
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes_in_use = 0;     // requested and not yet deallocated
+    size_t peak_bytes = 0;       // high-water mark of bytes_in_use
+    size_t reserved_bytes = 0;   // obtained from the layer below
+    double seconds = 0.0;        // spent inside allocate()
+};
+
+namespace detail {
+
+class AllocationTimer {
+public:
+    explicit AllocationTimer(AllocationStats& stats)
+        : stats_(stats), start_(std::chrono::steady_clock::now()) {}
+    ~AllocationTimer() {
+        stats_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    AllocationStats& stats_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline void recordAllocation(AllocationStats& stats, size_t bytes) {
+    ++stats.allocations;
+    stats.bytes_in_use += bytes;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.bytes_in_use);
+}
+
+inline void recordDeallocation(AllocationStats& stats, size_t bytes) {
+    ++stats.deallocations;
+    stats.bytes_in_use -= std::min(stats.bytes_in_use, bytes);
+}
+
+inline size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace detail
+
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DEFAULT_CHUNK_BYTES = 64 * 1024 * 1024;
+
+    // budget_bytes = 0: unlimited. Requests larger than a chunk get a chunk
+    // of their own.
+    explicit ArenaResource(size_t budget_bytes = 0, size_t chunk_bytes = DEFAULT_CHUNK_BYTES,
+                           PagePolicy policy = PagePolicy::Huge)
+        : budget_(budget_bytes), chunk_bytes_(std::max(chunk_bytes, HUGE_PAGE_SIZE)), policy_(policy) {}
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Rewind all chunks and clear the counters; reserved memory is kept
+    void reset() {
+        for (auto& chunk : chunks_) {
+            chunk.used = 0;
+        }
+        current_ = 0;
+        stats_ = AllocationStats{};
+        stats_.reserved_bytes = reservedBytes();
+    }
+
+    // Unmap every chunk
+    void release() {
+        chunks_.clear();
+        current_ = 0;
+        stats_ = AllocationStats{};
+    }
+
+    const AllocationStats& stats() const { return stats_; }
+    size_t budget() const { return budget_; }
+
+private:
+    struct Chunk {
+        HugePageArray<std::byte> memory;
+        size_t used = 0;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        detail::AllocationTimer timer(stats_);
+        bytes = std::max<size_t>(bytes, 1);
+        // Later chunks are tried only after earlier ones are full, so the
+        // bump order, and with it the layout, repeats after reset()
+        for (; current_ < chunks_.size(); ++current_) {
+            if (void* p = bump(chunks_[current_], bytes, alignment)) {
+                detail::recordAllocation(stats_, bytes);
+                return p;
+            }
+        }
+        const size_t size = detail::alignUp(std::max(chunk_bytes_, bytes + alignment), HUGE_PAGE_SIZE);
+        if (budget_ > 0 && reservedBytes() + size > budget_) {
+            throw std::bad_alloc();
+        }
+        chunks_.push_back(Chunk{HugePageArray<std::byte>(size, policy_), 0});
+        stats_.reserved_bytes = reservedBytes();
+        current_ = chunks_.size() - 1;
+        void* p = bump(chunks_.back(), bytes, alignment);
+        detail::recordAllocation(stats_, bytes);
+        return p;
+    }
+
+    void do_deallocate(void*, size_t bytes, size_t) override {
+        detail::recordDeallocation(stats_, std::max<size_t>(bytes, 1));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    static void* bump(Chunk& chunk, size_t bytes, size_t alignment) {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(chunk.memory.data());
+        const size_t offset = detail::alignUp(base + chunk.used, alignment) - base;
+        if (offset + bytes > chunk.memory.size()) {
+            return nullptr;
+        }
+        chunk.used = offset + bytes;
+        return chunk.memory.data() + offset;
+    }
+
+    size_t reservedBytes() const {
+        size_t total = 0;
+        for (const auto& chunk : chunks_) {
+            total += chunk.memory.size();
+        }
+        return total;
+    }
+
+    size_t budget_;
+    size_t chunk_bytes_;
+    PagePolicy policy_;
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    AllocationStats stats_;
+};
+
+class PoolResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t MIN_CLASS_BYTES = 16;
+    static constexpr size_t MAX_CLASS_BYTES = 64 * 1024;
+    // Class blocks are aligned to their size up to this; stricter requests
+    // go straight to the upstream resource
+    static constexpr size_t MAX_CLASS_ALIGNMENT = 4096;
+
+    explicit PoolResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {}
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    // Forget all free blocks and clear the counters. Call after (or instead
+    // of) resetting an arena upstream; with another upstream the free blocks
+    // are leaked to it.
+    void reset() {
+        std::fill(std::begin(free_lists_), std::end(free_lists_), nullptr);
+        large_blocks_.clear();
+        large_free_.clear();
+        stats_ = AllocationStats{};
+    }
+
+    const AllocationStats& stats() const { return stats_; }
+    std::pmr::memory_resource* upstream() const { return upstream_; }
+
+private:
+    static constexpr int CLASS_COUNT = 13;  // 16 B << 0 .. 16 B << 12 = 64 KB
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct LargeBlock {
+        void* p;
+        size_t bytes;
+        size_t alignment;
+    };
+
+    static int sizeClass(size_t bytes) {
+        int index = 0;
+        size_t size = MIN_CLASS_BYTES;
+        while (size < bytes) {
+            size <<= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    static size_t classBytes(int index) { return MIN_CLASS_BYTES << index; }
+
+    static bool isLarge(size_t bytes, size_t alignment) {
+        return std::max(bytes, alignment) > MAX_CLASS_BYTES || alignment > MAX_CLASS_ALIGNMENT;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        detail::AllocationTimer timer(stats_);
+        detail::recordAllocation(stats_, bytes);
+        if (isLarge(bytes, alignment)) {
+            // Best fit among freed large blocks, if not wasting more than half
+            auto best = large_free_.end();
+            for (auto it = large_free_.begin(); it != large_free_.end(); ++it) {
+                if (it->bytes >= bytes && it->bytes <= 2 * bytes && it->alignment >= alignment &&
+                    (best == large_free_.end() || it->bytes < best->bytes)) {
+                    best = it;
+                }
+            }
+            if (best != large_free_.end()) {
+                void* p = best->p;
+                large_blocks_.push_back(*best);
+                large_free_.erase(best);
+                return p;
+            }
+            void* p = upstream_->allocate(bytes, alignment);
+            stats_.reserved_bytes += bytes;
+            large_blocks_.push_back(LargeBlock{p, bytes, alignment});
+            return p;
+        }
+        const int index = sizeClass(std::max({bytes, alignment, MIN_CLASS_BYTES}));
+        if (FreeBlock* block = free_lists_[index]) {
+            free_lists_[index] = block->next;
+            return block;
+        }
+        const size_t size = classBytes(index);
+        stats_.reserved_bytes += size;
+        return upstream_->allocate(size, std::min(size, MAX_CLASS_ALIGNMENT));
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        detail::recordDeallocation(stats_, bytes);
+        if (isLarge(bytes, alignment)) {
+            auto it = std::find_if(large_blocks_.begin(), large_blocks_.end(),
+                                   [p](const LargeBlock& block) { return block.p == p; });
+            if (it != large_blocks_.end()) {
+                large_free_.push_back(*it);
+                large_blocks_.erase(it);
+            }
+            return;
+        }
+        const int index = sizeClass(std::max({bytes, alignment, MIN_CLASS_BYTES}));
+        free_lists_[index] = new (p) FreeBlock{free_lists_[index]};
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    FreeBlock* free_lists_[CLASS_COUNT] = {};
+    // Large blocks in use / free for reuse; a handful per benchmark, so
+    // linear search is fine
+    std::vector<LargeBlock> large_blocks_;
+    std::vector<LargeBlock> large_free_;
+    AllocationStats stats_;
+};
+
+// Makes resource the std::pmr default resource until the end of the scope
+class ScopedDefaultResource {
+public:
+    explicit ScopedDefaultResource(std::pmr::memory_resource* resource)
+        : previous_(std::pmr::set_default_resource(resource)) {}
+    ~ScopedDefaultResource() { std::pmr::set_default_resource(previous_); }
+
+    ScopedDefaultResource(const ScopedDefaultResource&) = delete;
+    ScopedDefaultResource& operator=(const ScopedDefaultResource&) = delete;
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace hpc
@@ -0,0 +1,176 @@
+#pragma once
+
+// Batched GEMM for many small matrices of one compile-time size.
+//
+// gemm() is built for one large problem: packing, blocking and edge
+// handling cost more than the arithmetic of a 4x4 or 16x16 multiply. Here
+// M, N and K are template parameters, so every loop bound is a constant,
+// the register block unrolls completely and there are no remainder loops or
+// bounds checks. The batch is stored interleaved ("compact" layout):
+// matrices are grouped BATCH_LANES at a time and element (i, j) of all
+// matrices in a group is contiguous,
+//
+//   group g, element e, lane l  ->  data[(g * rows * cols + e) * BATCH_LANES + l]
+//
+// so one SIMD register holds the same element of BATCH_LANES different
+// matrices and the kernel vectorizes across matrices, never across a row:
+// no lane is wasted however small or odd the size. Groups are independent
+// and are spread over OpenMP threads.
+//
+// interleaveBatch() / deinterleaveBatch() convert from / to an array of
+// contiguous row-major matrices. The last group is zero-padded.
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace hpc {
+
+// Matrices per interleaved group: one SIMD register of floats
+#if defined(__AVX512F__)
+constexpr int BATCH_LANES = 16;
+#elif defined(__AVX__)
+constexpr int BATCH_LANES = 8;
+#else
+constexpr int BATCH_LANES = 4;
+#endif
+
+// Floats needed to hold count interleaved rows x cols matrices
+inline size_t batchStorageSize(int rows, int cols, size_t count) {
+    size_t groups = (count + BATCH_LANES - 1) / BATCH_LANES;
+    return groups * static_cast<size_t>(rows) * cols * BATCH_LANES;
+}
+
+// count contiguous row-major rows x cols matrices -> interleaved layout
+inline void interleaveBatch(const float* matrices, int rows, int cols, size_t count, float* out) {
+    const size_t elems = static_cast<size_t>(rows) * cols;
+    const size_t groups = (count + BATCH_LANES - 1) / BATCH_LANES;
+    for (size_t g = 0; g < groups; ++g) {
+        float* group = out + g * elems * BATCH_LANES;
+        for (int l = 0; l < BATCH_LANES; ++l) {
+            size_t m = g * BATCH_LANES + l;
+            for (size_t e = 0; e < elems; ++e) {
+                group[e * BATCH_LANES + l] = m < count ? matrices[m * elems + e] : 0.0f;
+            }
+        }
+    }
+}
+
+// Interleaved layout -> count contiguous row-major rows x cols matrices
+inline void deinterleaveBatch(const float* in, int rows, int cols, size_t count, float* matrices) {
+    const size_t elems = static_cast<size_t>(rows) * cols;
+    for (size_t m = 0; m < count; ++m) {
+        const float* group = in + (m / BATCH_LANES) * elems * BATCH_LANES;
+        const size_t l = m % BATCH_LANES;
+        for (size_t e = 0; e < elems; ++e) {
+            matrices[m * elems + e] = group[e * BATCH_LANES + l];
+        }
+    }
+}
+
+namespace detail {
+
+// Register block of C: rows x cols accumulators, each BATCH_LANES wide, are
+// updated per k from rows A loads and cols B loads. Block sizes are the
+// largest divisors of M / N up to the limits, so there are no remainder
+// loops; the limits keep accumulators plus operands within the 32 (AVX-512)
+// or 16 (AVX, SSE) vector registers.
+constexpr int BATCH_ROW_BLOCK = 2;
+#if defined(__AVX512F__)
+constexpr int BATCH_COL_BLOCK = 8;
+#else
+constexpr int BATCH_COL_BLOCK = 4;
+#endif
+
+constexpr int largestDivisorUpTo(int n, int limit) {
+    for (int d = std::min(n, limit); d > 1; --d) {
+        if (n % d == 0) {
+            return d;
+        }
+    }
+    return 1;
+}
+
+// One interleaved group: C (M x N) = [C +] A (M x K) * B (K x N), each
+// element a vector of BATCH_LANES independent matrices
+template <int M, int N, int K>
+inline void batchGroupKernel(const float* __restrict a, const float* __restrict b,
+                             float* __restrict c, bool accumulate) {
+    constexpr int L = BATCH_LANES;
+    constexpr int IB = largestDivisorUpTo(M, BATCH_ROW_BLOCK);
+    constexpr int JB = largestDivisorUpTo(N, BATCH_COL_BLOCK);
+    // The register block is unrolled completely. k is unrolled by 4 only:
+    // unrolling it fully made the 16x16 / 32x32 kernels slower (i-cache)
+    // and took a minute to compile.
+    for (int i0 = 0; i0 < M; i0 += IB) {
+        for (int j0 = 0; j0 < N; j0 += JB) {
+            alignas(64) float acc[IB][JB][L];
+#pragma GCC unroll 8
+            for (int ii = 0; ii < IB; ++ii) {
+#pragma GCC unroll 8
+                for (int jj = 0; jj < JB; ++jj) {
+                    const float* c_ij = c + ((i0 + ii) * N + j0 + jj) * L;
+                    #pragma omp simd
+                    for (int l = 0; l < L; ++l) {
+                        acc[ii][jj][l] = accumulate ? c_ij[l] : 0.0f;
+                    }
+                }
+            }
+#pragma GCC unroll 4
+            for (int k = 0; k < K; ++k) {
+                const float* b_k = b + (k * N + j0) * L;
+#pragma GCC unroll 8
+                for (int ii = 0; ii < IB; ++ii) {
+                    const float* a_ik = a + ((i0 + ii) * K + k) * L;
+#pragma GCC unroll 8
+                    for (int jj = 0; jj < JB; ++jj) {
+                        #pragma omp simd
+                        for (int l = 0; l < L; ++l) {
+                            acc[ii][jj][l] += a_ik[l] * b_k[jj * L + l];
+                        }
+                    }
+                }
+            }
+#pragma GCC unroll 8
+            for (int ii = 0; ii < IB; ++ii) {
+#pragma GCC unroll 8
+                for (int jj = 0; jj < JB; ++jj) {
+                    float* c_ij = c + ((i0 + ii) * N + j0 + jj) * L;
+                    #pragma omp simd
+                    for (int l = 0; l < L; ++l) {
+                        c_ij[l] = acc[ii][jj][l];
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+// C[m] = A[m] * B[m] (or C[m] += A[m] * B[m]) for m in [0, count), all in
+// the interleaved layout. num_threads <= 0 uses omp_get_max_threads().
+template <int M, int N, int K>
+inline void gemmBatch(size_t count, const float* A, const float* B, float* C,
+                      bool accumulate = false, int num_threads = 0) {
+    static_assert(M > 0 && N > 0 && K > 0, "batched GEMM sizes must be positive");
+    constexpr size_t a_group = static_cast<size_t>(M) * K * BATCH_LANES;
+    constexpr size_t b_group = static_cast<size_t>(K) * N * BATCH_LANES;
+    constexpr size_t c_group = static_cast<size_t>(M) * N * BATCH_LANES;
+    const long long groups = static_cast<long long>((count + BATCH_LANES - 1) / BATCH_LANES);
+
+#ifdef _OPENMP
+    const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+    #pragma omp parallel for schedule(static) num_threads(threads) if(groups > 1 && threads > 1)
+#else
+    (void)num_threads;
+#endif
+    for (long long g = 0; g < groups; ++g) {
+        detail::batchGroupKernel<M, N, K>(A + g * a_group, B + g * b_group, C + g * c_group, accumulate);
+    }
+}
+
+} // namespace hpc
@@ -0,0 +1,458 @@
+#pragma once
+
+// Repeated, statistically summarized kernel timing for the demos.
+//
+//   hpc::BenchStats s = hpc::benchmark("blocked multiply", n * n * n, [&] { multiply(A, B, C); });
+//   spdlog::info("{:.2f} ms (p99 {:.2f} ms)", s.median * 1e3, s.p99 * 1e3);
+//
+// benchmark() times kernel() in samples:
+//   - warm-up: the kernel runs for at least warmup_seconds (at least once)
+//     before anything is recorded. The warm-up also sizes a batch: kernels
+//     faster than min_sample_seconds run several times per sample, so the
+//     clock's resolution never rounds a sample to 0.
+//   - samples are taken until the 95% confidence interval of the mean is
+//     within rel_ci of the mean (after min_runs samples), max_runs samples
+//     were taken, or max_seconds have passed (after 2 samples).
+//   - the measured samples run inside a PerfRegion, so the counter report
+//     (perf_counters.h) covers every measured call.
+// A compiler barrier (clobberMemory) after every call keeps the calls of a
+// batch from being merged or hoisted; doNotOptimize(x) keeps a value the
+// kernel computes from being optimized away.
+//
+// BenchStats holds per-call seconds: min, median, mean, p99 (nearest rank,
+// so the maximum below 100 samples), standard deviation, the CI half-width
+// and the number of Tukey outliers (beyond 1.5 IQR outside the quartiles),
+// which point at interference from other processes.
+//
+// Work that cannot simply be repeated is timed by the caller: with a setup
+// function, setup() runs untimed before every call (one call per sample);
+// benchRecord() summarizes samples the caller measured itself, e.g. the
+// steps of a simulation.
+//
+// Every result is kept for writeBenchJson(). parseBenchArgs() reads
+//   --json PATH          write the results to PATH (see writeBenchJson)
+//   --pin CPUS           pin the benchmarking thread, e.g. 2 or 0-3,8
+//   --bench-time SECONDS max_seconds per benchmark
+//   --bench-ci FRACTION  rel_ci
+// Pinning applies to the calling thread and to threads it creates later,
+// OpenMP workers included, so pin parallel kernels to a set of CPUs.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "perf_counters.h"
+
+namespace hpc {
+
+struct BenchConfig {
+    double warmup_seconds = 0.1;
+    double min_sample_seconds = 1e-3;  // batch size target for fast kernels
+    int min_runs = 5;
+    int max_runs = 200;
+    double max_seconds = 0.5;          // sampling budget per benchmark
+    double rel_ci = 0.01;              // stop once CI95 half-width <= rel_ci * mean
+    std::string json_path;             // parseBenchArgs(): --json
+    std::string pinned_cpus;           // parseBenchArgs(): --pin
+};
+
+struct BenchStats {
+    std::string name;
+    uint64_t elements = 0;
+    int runs = 0;                 // samples
+    uint64_t calls_per_run = 1;
+    double min = 0.0;             // seconds per call
+    double median = 0.0;
+    double mean = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    double stddev = 0.0;
+    double ci95 = 0.0;            // half-width of the 95% CI of the mean
+    int outliers = 0;
+    bool converged = false;       // ci95 <= rel_ci * mean
+
+    double relCi() const { return mean > 0.0 ? ci95 / mean : 0.0; }
+    double nsPerElement() const { return elements > 0 ? median * 1e9 / static_cast<double>(elements) : 0.0; }
+
+    // One line: "name: median 1.23 ms (min 1.2, p99 1.41, ±0.8%, 25 runs x 4, 1 outlier)"
+    std::string summary() const {
+        double scale = 1.0;
+        const char* unit = "s";
+        if (median < 1e-6) {
+            scale = 1e9, unit = "ns";
+        } else if (median < 1e-3) {
+            scale = 1e6, unit = "μs";
+        } else if (median < 1.0) {
+            scale = 1e3, unit = "ms";
+        }
+        char buffer[192];
+        std::snprintf(buffer, sizeof(buffer), ": median %.4g %s (min %.4g, p99 %.4g, ±%.1f%%%s, %d runs x %llu, %d outlier%s)",
+                      median * scale, unit, min * scale, p99 * scale, relCi() * 100.0, converged ? "" : " unsettled",
+                      runs, static_cast<unsigned long long>(calls_per_run), outliers, outliers == 1 ? "" : "s");
+        return name + buffer;
+    }
+};
+
+// Keeps value (and everything it points to) alive and opaque to the optimizer
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+template <typename T>
+inline void doNotOptimize(T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+r,m"(value) : : "memory");
+#else
+    static volatile T* sink;
+    sink = &value;
+#endif
+}
+
+// All memory may have been read and written: stores before it must happen
+inline void clobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+namespace detail {
+
+struct BenchRegistry {
+    BenchConfig config;
+    std::vector<BenchStats> results;
+};
+
+inline BenchRegistry& benchRegistry() {
+    static BenchRegistry registry;
+    return registry;
+}
+
+// Two-sided 95% quantile of Student's t with df degrees of freedom
+inline double benchT95(int df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1) {
+        return 0.0;
+    }
+    if (df <= 30) {
+        return table[df - 1];
+    }
+    return df <= 60 ? 2.000 : df <= 120 ? 1.980 : 1.960;
+}
+
+// Running mean and variance (Welford) for the stopping rule
+struct BenchMoments {
+    int n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x) {
+        ++n;
+        const double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+    double stddev() const { return n > 1 ? std::sqrt(m2 / (n - 1)) : 0.0; }
+    double ci95() const { return n > 1 ? benchT95(n - 1) * stddev() / std::sqrt(static_cast<double>(n)) : 0.0; }
+};
+
+// Value at fraction q of sorted, interpolating between neighbours
+inline double benchQuantile(const std::vector<double>& sorted, double q) {
+    const double pos = q * static_cast<double>(sorted.size() - 1);
+    const size_t lo = static_cast<size_t>(pos);
+    const size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - static_cast<double>(lo));
+}
+
+inline BenchStats benchSummarize(std::string name, uint64_t elements, std::vector<double> samples,
+                                 uint64_t calls_per_run, double rel_ci) {
+    BenchStats stats;
+    stats.name = std::move(name);
+    stats.elements = elements;
+    stats.runs = static_cast<int>(samples.size());
+    stats.calls_per_run = calls_per_run;
+    if (samples.empty()) {
+        return stats;
+    }
+    BenchMoments moments;
+    for (double s : samples) {
+        moments.add(s);
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = benchQuantile(samples, 0.5);
+    stats.p99 = samples[static_cast<size_t>(std::ceil(0.99 * static_cast<double>(n))) - 1];
+    stats.mean = moments.mean;
+    stats.stddev = moments.stddev();
+    stats.ci95 = moments.ci95();
+    stats.converged = n > 1 && stats.ci95 <= rel_ci * stats.mean;
+    const double q1 = benchQuantile(samples, 0.25), q3 = benchQuantile(samples, 0.75);
+    const double fence = 1.5 * (q3 - q1);
+    stats.outliers = static_cast<int>(std::count_if(samples.begin(), samples.end(), [&](double s) {
+        return s < q1 - fence || s > q3 + fence;
+    }));
+    return stats;
+}
+
+inline std::function<void(const BenchStats&)>& benchSink() {
+    static std::function<void(const BenchStats&)> sink;
+    return sink;
+}
+
+inline BenchStats benchStore(BenchStats stats) {
+    auto& results = benchRegistry().results;
+    results.push_back(std::move(stats));
+    if (benchSink()) {
+        benchSink()(results.back());
+    }
+    return results.back();
+}
+
+inline double benchNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace detail
+
+// Receives every result as it is measured (e.g. to log BenchStats::summary())
+inline void setBenchSink(std::function<void(const BenchStats&)> sink) { detail::benchSink() = std::move(sink); }
+
+inline const BenchConfig& benchConfig() { return detail::benchRegistry().config; }
+
+// Restricts the calling thread (and threads it creates later) to cpus, a
+// list like "2" or "0-3,8"; false where affinity cannot be set
+inline bool pinCurrentThread(const std::string& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    size_t pos = 0;
+    while (pos < cpus.size()) {
+        size_t end = cpus.find(',', pos);
+        if (end == std::string::npos) {
+            end = cpus.size();
+        }
+        const std::string range = cpus.substr(pos, end - pos);
+        const size_t dash = range.find('-');
+        try {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                    throw std::invalid_argument(range);
+                }
+                CPU_SET(cpu, &set);
+            }
+        } catch (const std::exception&) {
+            throw std::invalid_argument("bad CPU list: " + cpus);
+        }
+        pos = end + 1;
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// Sets the configuration for later benchmarks and applies its pinning
+inline void configureBench(const BenchConfig& config) {
+    if (!config.pinned_cpus.empty() && !pinCurrentThread(config.pinned_cpus)) {
+        throw std::runtime_error("cannot pin to CPUs " + config.pinned_cpus);
+    }
+    detail::benchRegistry().config = config;
+}
+
+// The default configuration with the benchmark flags in argv applied
+// (other arguments are left to the caller); throws std::invalid_argument
+// for a flag without a valid value
+inline BenchConfig parseBenchArgs(int argc, char** argv) {
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag != "--json" && flag != "--pin" && flag != "--bench-time" && flag != "--bench-ci") {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(flag + " needs a value");
+        }
+        const std::string value = argv[++i];
+        try {
+            if (flag == "--json") {
+                config.json_path = value;
+            } else if (flag == "--pin") {
+                config.pinned_cpus = value;
+            } else if (flag == "--bench-time") {
+                config.max_seconds = std::stod(value);
+            } else {
+                config.rel_ci = std::stod(value);
+            }
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument("bad value for " + flag + ": " + value);
+        }
+    }
+    return config;
+}
+
+// Whether argv[i] is a benchmark flag or its value (for callers that look
+// for positional arguments)
+inline bool isBenchArg(int argc, char** argv, int i) {
+    auto flag = [&](int j) {
+        const std::string s = argv[j];
+        return s == "--json" || s == "--pin" || s == "--bench-time" || s == "--bench-ci";
+    };
+    return (i < argc && flag(i)) || (i > 0 && flag(i - 1));
+}
+
+// Summarizes samples (seconds, each covering calls_per_run calls) the
+// caller measured, keeps the result and returns a copy of it
+inline BenchStats benchRecord(const std::string& name, uint64_t elements, std::vector<double> samples,
+                              uint64_t calls_per_run = 1) {
+    for (double& s : samples) {
+        s /= static_cast<double>(calls_per_run);
+    }
+    return detail::benchStore(
+        detail::benchSummarize(name, elements, std::move(samples), calls_per_run, benchConfig().rel_ci));
+}
+
+namespace detail {
+
+// Takes samples (sample() returns the seconds of one, covering calls calls)
+// until the stopping rule holds, inside a counter region
+template <typename Sample>
+BenchStats benchSampling(const std::string& name, uint64_t elements, uint64_t calls, Sample&& sample) {
+    const BenchConfig& config = benchConfig();
+    std::vector<double> samples;
+    BenchMoments moments;
+    PerfRegion counters(name);
+    const double start = benchNow();
+    for (;;) {
+        samples.push_back(sample() / static_cast<double>(calls));
+        moments.add(samples.back());
+        if (moments.n >= config.max_runs ||
+            (moments.n >= config.min_runs && moments.ci95() <= config.rel_ci * moments.mean) ||
+            (moments.n >= 2 && benchNow() - start >= config.max_seconds)) {
+            break;
+        }
+    }
+    counters.setElements(elements * calls * samples.size());
+    counters.stop();
+    return benchStore(benchSummarize(name, elements, std::move(samples), calls, config.rel_ci));
+}
+
+} // namespace detail
+
+// Times kernel() as described at the top of this file; elements is the work
+// of one call, for the counters and BenchStats::nsPerElement()
+template <typename Kernel>
+BenchStats benchmark(const std::string& name, uint64_t elements, Kernel&& kernel) {
+    auto batch = [&](uint64_t calls) {
+        const double start = detail::benchNow();
+        for (uint64_t i = 0; i < calls; ++i) {
+            kernel();
+            clobberMemory();
+        }
+        return detail::benchNow() - start;
+    };
+    // Warm-up, doubling the batch until one takes min_sample_seconds
+    uint64_t calls = 1;
+    const double warmup_start = detail::benchNow();
+    for (;;) {
+        if (batch(calls) < benchConfig().min_sample_seconds) {
+            calls *= 2;
+        } else if (detail::benchNow() - warmup_start >= benchConfig().warmup_seconds) {
+            break;
+        }
+    }
+    return detail::benchSampling(name, elements, calls, [&] { return batch(calls); });
+}
+
+// As above with setup() run untimed before every call, for kernels that
+// need fresh input (a first touch, an in-place update); one call per sample
+template <typename Kernel, typename Setup>
+BenchStats benchmark(const std::string& name, uint64_t elements, Kernel&& kernel, Setup&& setup) {
+    auto call = [&] {
+        setup();
+        clobberMemory();
+        const double start = detail::benchNow();
+        kernel();
+        clobberMemory();
+        return detail::benchNow() - start;
+    };
+    const double warmup_start = detail::benchNow();
+    do {
+        call();
+    } while (detail::benchNow() - warmup_start < benchConfig().warmup_seconds);
+    return detail::benchSampling(name, elements, 1, call);
+}
+
+inline const std::vector<BenchStats>& benchResults() { return detail::benchRegistry().results; }
+
+// Results and configuration as JSON; times in nanoseconds per call
+inline nlohmann::json benchJson() {
+    const BenchConfig& config = benchConfig();
+    nlohmann::json results = nlohmann::json::array();
+    for (const BenchStats& s : benchResults()) {
+        results.push_back({{"name", s.name},
+                           {"elements", s.elements},
+                           {"runs", s.runs},
+                           {"calls_per_run", s.calls_per_run},
+                           {"min_ns", s.min * 1e9},
+                           {"median_ns", s.median * 1e9},
+                           {"mean_ns", s.mean * 1e9},
+                           {"p99_ns", s.p99 * 1e9},
+                           {"max_ns", s.max * 1e9},
+                           {"stddev_ns", s.stddev * 1e9},
+                           {"ci95_ns", s.ci95 * 1e9},
+                           {"ns_per_element", s.nsPerElement()},
+                           {"outliers", s.outliers},
+                           {"converged", s.converged}});
+    }
+    return {{"config",
+             {{"warmup_seconds", config.warmup_seconds},
+              {"min_sample_seconds", config.min_sample_seconds},
+              {"min_runs", config.min_runs},
+              {"max_runs", config.max_runs},
+              {"max_seconds", config.max_seconds},
+              {"rel_ci", config.rel_ci},
+              {"pinned_cpus", config.pinned_cpus},
+              {"hardware_threads", std::thread::hardware_concurrency()}}},
+            {"results", results}};
+}
+
+// Writes benchJson() to path; throws std::runtime_error if it cannot
+inline void writeBenchJson(const std::string& path) {
+    std::ofstream out(path);
+    out << benchJson().dump(2) << '\n';
+    if (!out) {
+        throw std::runtime_error("cannot write benchmark results to " + path);
+    }
+}
+
+} // namespace hpc
@@ -0,0 +1,330 @@
+#pragma once
+
+// Bulk copy / fill / scale at memory bandwidth.
+//
+// How a large buffer is written decides how much traffic it causes:
+//
+//   Regular    - ordinary vector stores. Each destination line is first
+//                read into the cache (read-for-ownership) and later written
+//                back, so a copy moves 3 bytes per byte copied; right for
+//                buffers that fit in the LLC and are read again soon.
+//   Streaming  - non-temporal stores + sfence. Whole lines go to memory
+//                through the write-combining buffers with no
+//                read-for-ownership and without evicting the rest of the
+//                working set: 2 bytes per byte copied. Only pays off beyond
+//                the LLC. The source is prefetched BULK_PREFETCH_BYTES ahead
+//                with prefetcht0 (prefetchnta throttled the loads and cost a
+//                third of the bandwidth).
+//   RepMovsb   - the string instruction (fill: rep stosd). With ERMS/FSRM
+//                the microcode picks its own store strategy and is the
+//                cheapest to start for small and medium copies. Scale has no
+//                string form and runs Regular.
+//   Auto       - Streaming when source + destination exceed the LLC
+//                (cache_topology.h), otherwise RepMovsb for copies of at
+//                least BULK_REP_MOVSB_MIN bytes on ERMS hosts, otherwise
+//                Regular.
+//
+// Buffers of at least BULK_PARALLEL_MIN bytes (source + destination) are
+// split over the OpenMP threads in page-aligned parts: one core cannot keep
+// enough misses in flight to saturate DRAM. threads > 0 forces a count.
+//
+// Copies must not overlap (as memcpy); scale may work in place. The vector
+// width follows the compile target, like transpose.h; without SSE, NEON
+// included, streaming stores fall back to regular ones.
+//
+//   hpc::bulkCopy(dst, src, bytes);                     // Auto
+//   hpc::bulkFill(out, 0.0f, n, hpc::BulkStore::Streaming);
+//   hpc::bulkScale(out, in, 0.5f, n);
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#define HPC_BULK_REP_STRING 1
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "cache_topology.h"
+
+namespace hpc {
+
+enum class BulkStore { Regular, Streaming, RepMovsb, Auto };
+
+inline const char* bulkStoreName(BulkStore store) {
+    switch (store) {
+        case BulkStore::Regular: return "regular";
+        case BulkStore::Streaming: return "streaming";
+        case BulkStore::RepMovsb: return "rep movsb";
+        case BulkStore::Auto: return "auto";
+    }
+    return "unknown";
+}
+
+// Source + destination bytes from which the work is split over threads
+constexpr size_t BULK_PARALLEL_MIN = size_t(16) << 20;
+// Smallest copy Auto hands to rep movsb
+constexpr size_t BULK_REP_MOVSB_MIN = 2048;
+// How far ahead of the loads the streaming loops prefetch the source
+constexpr size_t BULK_PREFETCH_BYTES = 1024;
+
+namespace detail {
+
+constexpr size_t BULK_LINE = 64;
+// Threads split the work at multiples of this (one page)
+constexpr size_t BULK_SPLIT = 4096;
+
+#if defined(__AVX512F__)
+using BulkVec = __m512;
+constexpr size_t BULK_VECTOR = 16;
+inline BulkVec bulkLoad(const float* p) { return _mm512_loadu_ps(p); }
+inline void bulkStore(float* p, BulkVec v) { _mm512_storeu_ps(p, v); }
+inline void bulkStream(float* p, BulkVec v) { _mm512_stream_ps(p, v); }
+inline BulkVec bulkBroadcast(float v) { return _mm512_set1_ps(v); }
+inline BulkVec bulkMul(BulkVec a, BulkVec b) { return _mm512_mul_ps(a, b); }
+#elif defined(__AVX__)
+using BulkVec = __m256;
+constexpr size_t BULK_VECTOR = 8;
+inline BulkVec bulkLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void bulkStore(float* p, BulkVec v) { _mm256_storeu_ps(p, v); }
+inline void bulkStream(float* p, BulkVec v) { _mm256_stream_ps(p, v); }
+inline BulkVec bulkBroadcast(float v) { return _mm256_set1_ps(v); }
+inline BulkVec bulkMul(BulkVec a, BulkVec b) { return _mm256_mul_ps(a, b); }
+#elif defined(__SSE__)
+using BulkVec = __m128;
+constexpr size_t BULK_VECTOR = 4;
+inline BulkVec bulkLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void bulkStore(float* p, BulkVec v) { _mm_storeu_ps(p, v); }
+inline void bulkStream(float* p, BulkVec v) { _mm_stream_ps(p, v); }
+inline BulkVec bulkBroadcast(float v) { return _mm_set1_ps(v); }
+inline BulkVec bulkMul(BulkVec a, BulkVec b) { return _mm_mul_ps(a, b); }
+#else
+// One float at a time; the compiler vectorizes the line loops
+using BulkVec = float;
+constexpr size_t BULK_VECTOR = 1;
+inline BulkVec bulkLoad(const float* p) { return *p; }
+inline void bulkStore(float* p, BulkVec v) { *p = v; }
+inline void bulkStream(float* p, BulkVec v) { *p = v; }
+inline BulkVec bulkBroadcast(float v) { return v; }
+inline BulkVec bulkMul(BulkVec a, BulkVec b) { return a * b; }
+#endif
+
+inline void bulkPrefetch(const void* p) {
+#if defined(__SSE__)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+inline void bulkFence() {
+#if defined(__SSE__)
+    _mm_sfence();
+#endif
+}
+
+// Enhanced rep movsb / stosb (CPUID.7.0:EBX bit 9)
+inline bool bulkHasErms() {
+#if defined(HPC_BULK_REP_STRING)
+    static const bool erms = [] {
+        unsigned eax, ebx, ecx, edx;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 9));
+    }();
+    return erms;
+#else
+    return false;
+#endif
+}
+
+inline void bulkRepMovsb(void* dst, const void* src, size_t bytes) {
+#if defined(HPC_BULK_REP_STRING)
+    asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(bytes) : : "memory");
+#else
+    std::memcpy(dst, src, bytes);
+#endif
+}
+
+inline void bulkRepStosd(float* dst, float value, size_t n) {
+#if defined(HPC_BULK_REP_STRING)
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    asm volatile("rep stosl" : "+D"(dst), "+c"(n) : "a"(bits) : "memory");
+#else
+    std::fill(dst, dst + n, value);
+#endif
+}
+
+// Element operations for bulkMap. Reads: whether src is used.
+struct BulkCopyOp {
+    static constexpr bool reads = true;
+    BulkVec operator()(BulkVec v) const { return v; }
+    float scalar(float v) const { return v; }
+};
+
+struct BulkFillOp {
+    static constexpr bool reads = false;
+    float value;
+    BulkVec vector;
+    BulkVec operator()(BulkVec) const { return vector; }
+    float scalar(float) const { return value; }
+};
+
+struct BulkScaleOp {
+    static constexpr bool reads = true;
+    float factor;
+    BulkVec vector;
+    BulkVec operator()(BulkVec v) const { return bulkMul(v, vector); }
+    float scalar(float v) const { return v * factor; }
+};
+
+// dst[i] = op(src[i]) for n floats on one thread. With stream, the part of
+// dst between the first and last line boundary gets non-temporal stores,
+// one whole line per iteration, with the source prefetched ahead.
+template <typename Op>
+inline void bulkMap(float* dst, const float* src, size_t n, bool stream, const Op& op) {
+    constexpr size_t LINE_FLOATS = BULK_LINE / sizeof(float);
+    size_t i = 0;
+    if (stream) {
+        const size_t misalign = reinterpret_cast<uintptr_t>(dst) % BULK_LINE;
+        size_t head = misalign == 0 ? 0 : (BULK_LINE - misalign) / sizeof(float);
+        if (misalign % sizeof(float) != 0) {
+            head = n;  // dst not float-aligned: no line boundary to stream from
+        }
+        head = std::min(head, n);
+        for (; i < head; ++i) {
+            dst[i] = op.scalar(Op::reads ? src[i] : 0.0f);
+        }
+        for (; i + LINE_FLOATS <= n; i += LINE_FLOATS) {
+            if constexpr (Op::reads) {
+                bulkPrefetch(reinterpret_cast<const char*>(src + i) + BULK_PREFETCH_BYTES);
+            }
+            for (size_t v = 0; v < LINE_FLOATS; v += BULK_VECTOR) {
+                bulkStream(dst + i + v, op(Op::reads ? bulkLoad(src + i + v) : BulkVec{}));
+            }
+        }
+    } else {
+        for (; i + BULK_VECTOR <= n; i += BULK_VECTOR) {
+            bulkStore(dst + i, op(Op::reads ? bulkLoad(src + i) : BulkVec{}));
+        }
+    }
+    for (; i < n; ++i) {
+        dst[i] = op.scalar(Op::reads ? src[i] : 0.0f);
+    }
+}
+
+inline int bulkThreads(size_t bytes_touched, int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+#ifdef _OPENMP
+    return bytes_touched >= BULK_PARALLEL_MIN ? omp_get_max_threads() : 1;
+#else
+    (void)bytes_touched;
+    return 1;
+#endif
+}
+
+// Runs part(begin, end) over [0, bytes) split in threads page-aligned
+// ranges; each thread fences its own streaming stores
+template <typename Part>
+inline void bulkParallel(size_t bytes, int threads, bool stream, Part&& part) {
+    const size_t pages = (bytes + BULK_SPLIT - 1) / BULK_SPLIT;
+    threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(threads, pages)));
+    #pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        int id = 0, count = 1;
+#ifdef _OPENMP
+        id = omp_get_thread_num();
+        count = omp_get_num_threads();
+#endif
+        const size_t begin = std::min(bytes, pages * id / count * BULK_SPLIT);
+        const size_t end = std::min(bytes, pages * (id + 1) / count * BULK_SPLIT);
+        if (begin < end) {
+            part(begin, end);
+        }
+        if (stream) {
+            bulkFence();
+        }
+    }
+}
+
+} // namespace detail
+
+// Strategy Auto picks for an operation touching bytes_touched bytes
+// (source + destination)
+inline BulkStore bulkAutoStore(size_t bytes_touched, bool copy) {
+    if (bytes_touched > cacheTopology().dataCacheSize(3, 8 * 1024 * 1024)) {
+        return BulkStore::Streaming;
+    }
+    if (copy && bytes_touched / 2 >= BULK_REP_MOVSB_MIN && detail::bulkHasErms()) {
+        return BulkStore::RepMovsb;
+    }
+    return BulkStore::Regular;
+}
+
+inline void bulkCopy(void* dst, const void* src, size_t bytes, BulkStore store = BulkStore::Auto,
+                     int threads = 0) {
+    if (store == BulkStore::Auto) {
+        store = bulkAutoStore(2 * bytes, true);
+    }
+    const bool stream = store == BulkStore::Streaming;
+    auto* out = static_cast<unsigned char*>(dst);
+    const auto* in = static_cast<const unsigned char*>(src);
+    detail::bulkParallel(bytes, detail::bulkThreads(2 * bytes, threads), stream, [&](size_t begin, size_t end) {
+        if (store == BulkStore::RepMovsb) {
+            detail::bulkRepMovsb(out + begin, in + begin, end - begin);
+            return;
+        }
+        // Byte head up to a float boundary of dst, float body, byte tail
+        const size_t head = std::min(end - begin, (sizeof(float) - reinterpret_cast<uintptr_t>(out + begin) %
+                                                   sizeof(float)) % sizeof(float));
+        std::memcpy(out + begin, in + begin, head);
+        const size_t floats = (end - begin - head) / sizeof(float);
+        detail::bulkMap(reinterpret_cast<float*>(out + begin + head),
+                        reinterpret_cast<const float*>(in + begin + head), floats, stream, detail::BulkCopyOp{});
+        const size_t done = head + floats * sizeof(float);
+        std::memcpy(out + begin + done, in + begin + done, end - begin - done);
+    });
+}
+
+inline void bulkFill(float* dst, float value, size_t n, BulkStore store = BulkStore::Auto, int threads = 0) {
+    const size_t bytes = n * sizeof(float);
+    if (store == BulkStore::Auto) {
+        store = bulkAutoStore(bytes, false);
+    }
+    const bool stream = store == BulkStore::Streaming;
+    const detail::BulkFillOp op{value, detail::bulkBroadcast(value)};
+    detail::bulkParallel(bytes, detail::bulkThreads(bytes, threads), stream, [&](size_t begin, size_t end) {
+        float* out = dst + begin / sizeof(float);
+        const size_t count = (end - begin) / sizeof(float);
+        if (store == BulkStore::RepMovsb) {
+            detail::bulkRepStosd(out, value, count);
+        } else {
+            detail::bulkMap(out, nullptr, count, stream, op);
+        }
+    });
+}
+
+// dst[i] = src[i] * factor; dst == src is allowed
+inline void bulkScale(float* dst, const float* src, float factor, size_t n, BulkStore store = BulkStore::Auto,
+                      int threads = 0) {
+    const size_t bytes = n * sizeof(float);
+    if (store == BulkStore::Auto) {
+        store = bulkAutoStore(2 * bytes, false);
+    }
+    const bool stream = store == BulkStore::Streaming;
+    const detail::BulkScaleOp op{factor, detail::bulkBroadcast(factor)};
+    detail::bulkParallel(bytes, detail::bulkThreads(2 * bytes, threads), stream, [&](size_t begin, size_t end) {
+        const size_t first = begin / sizeof(float);
+        detail::bulkMap(dst + first, src + first, (end - begin) / sizeof(float), stream, op);
+    });
+}
+
+} // namespace hpc
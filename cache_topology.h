@@ -0,0 +1,331 @@
+#pragma once
+
+// Runtime CPU cache topology.
+//
+// Linux: every /sys/devices/system/cpu/cpuN/cache/indexM directory of an
+// online cpuN describes one cache as seen from cpuN; caches with the same
+// level, type and shared_cpu_list are the same physical instance. Other
+// platforms (or a sysfs that is not mounted, as in some containers) fall
+// back to CPUID leaf 4 / 0x8000001D on x86 and hw.* sysctls on macOS. If
+// nothing works the old hard-coded guesses are used, so callers always get
+// usable values.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+namespace hpc {
+
+struct CacheLevel {
+    int level = 0;
+    std::string type;               // "Data", "Instruction" or "Unified"
+    size_t size_bytes = 0;
+    size_t line_size = 0;
+    int associativity = 0;          // 0 = unknown, -1 = fully associative
+    std::string shared_cpu_list;    // e.g. "0-7,32-39"; empty when unknown
+    int sharing_cpus = 0;           // logical CPUs sharing one instance
+    int instances = 0;              // distinct instances in the system
+};
+
+struct CacheTopology {
+    std::string source;             // "sysfs", "cpuid", "sysctl" or "defaults"
+    size_t line_size = 64;
+    std::vector<CacheLevel> levels; // sorted by level, data/unified before instruction
+
+    // Data or unified cache at the given level; nullptr if the level is absent
+    const CacheLevel* dataCache(int level) const {
+        for (const auto& cache : levels) {
+            if (cache.level == level && cache.type != "Instruction") {
+                return &cache;
+            }
+        }
+        return nullptr;
+    }
+
+    // Capacity of a data/unified level, or fallback when it does not exist
+    size_t dataCacheSize(int level, size_t fallback) const {
+        const CacheLevel* cache = dataCache(level);
+        return cache && cache->size_bytes > 0 ? cache->size_bytes : fallback;
+    }
+
+    // Bytes between addresses that map to the same L1D set (size / ways).
+    // Row pitches that are multiples of this thrash a single set.
+    size_t l1SetAliasingStride() const {
+        const CacheLevel* l1 = dataCache(1);
+        if (!l1 || l1->associativity <= 0 || l1->size_bytes == 0) {
+            return 4096;
+        }
+        return l1->size_bytes / l1->associativity;
+    }
+};
+
+namespace detail {
+
+inline bool readSysfsLine(const std::string& path, std::string& value) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, value));
+}
+
+// "48K", "2048K", "300M" -> bytes
+inline size_t parseCacheSize(const std::string& text) {
+    size_t value = 0;
+    size_t pos = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+        value = value * 10 + static_cast<size_t>(text[pos] - '0');
+        ++pos;
+    }
+    if (pos < text.size()) {
+        switch (text[pos]) {
+            case 'K': case 'k': value *= 1024; break;
+            case 'M': case 'm': value *= 1024 * 1024; break;
+            case 'G': case 'g': value *= 1024ull * 1024 * 1024; break;
+        }
+    }
+    return value;
+}
+
+// CPU ids in a list like "0-3,8,10-11"
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Number of CPUs in a list like "0-3,8,10-11"
+inline int countCpuList(const std::string& list) {
+    return static_cast<int>(parseCpuList(list).size());
+}
+
+inline void sortLevels(std::vector<CacheLevel>& levels) {
+    std::sort(levels.begin(), levels.end(), [](const CacheLevel& a, const CacheLevel& b) {
+        bool a_instruction = a.type == "Instruction";
+        bool b_instruction = b.type == "Instruction";
+        return std::tie(a.level, a_instruction) < std::tie(b.level, b_instruction);
+    });
+}
+
+inline bool detectFromSysfs(CacheTopology& topology) {
+    std::vector<CacheLevel> levels;
+    std::set<std::tuple<int, std::string, std::string>> seen_instances;
+
+    // Online CPU ids need not be contiguous (offline or hot-plugged CPUs),
+    // and a CPU without a cache directory is skipped, not the end of the scan
+    std::string online;
+    if (!readSysfsLine("/sys/devices/system/cpu/online", online)) {
+        return false;
+    }
+    for (int cpu : parseCpuList(online)) {
+        std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache";
+        std::string probe;
+        if (!readSysfsLine(cpu_dir + "/index0/level", probe)) {
+            continue;
+        }
+        for (int index = 0;; ++index) {
+            std::string dir = cpu_dir + "/index" + std::to_string(index) + "/";
+            std::string level_text, type, size_text, ways_text, line_text, shared;
+            if (!readSysfsLine(dir + "level", level_text)) {
+                break;
+            }
+            readSysfsLine(dir + "type", type);
+            readSysfsLine(dir + "size", size_text);
+            readSysfsLine(dir + "ways_of_associativity", ways_text);
+            readSysfsLine(dir + "coherency_line_size", line_text);
+            readSysfsLine(dir + "shared_cpu_list", shared);
+
+            int level = std::atoi(level_text.c_str());
+            if (!seen_instances.insert({level, type, shared}).second) {
+                continue;
+            }
+            auto existing = std::find_if(levels.begin(), levels.end(), [&](const CacheLevel& c) {
+                return c.level == level && c.type == type;
+            });
+            if (existing != levels.end()) {
+                ++existing->instances;
+                continue;
+            }
+
+            CacheLevel cache;
+            cache.level = level;
+            cache.type = type;
+            cache.size_bytes = parseCacheSize(size_text);
+            cache.line_size = static_cast<size_t>(std::atoi(line_text.c_str()));
+            cache.associativity = std::atoi(ways_text.c_str());
+            cache.shared_cpu_list = shared;
+            cache.sharing_cpus = countCpuList(shared);
+            cache.instances = 1;
+            levels.push_back(cache);
+        }
+    }
+
+    if (levels.empty()) {
+        return false;
+    }
+    sortLevels(levels);
+    topology.levels = levels;
+    topology.source = "sysfs";
+    return true;
+}
+
+inline bool detectFromCpuid(CacheTopology& topology) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    // ebx/edx/ecx spell the vendor: "GenuineIntel" or "AuthenticAMD"/"HygonGenuine"
+    bool amd = ebx == 0x68747541 || ebx == 0x6f677948;
+    unsigned leaf = amd ? 0x8000001D : 4;
+    if (amd) {
+        unsigned max_extended = __get_cpuid_max(0x80000000, nullptr);
+        if (max_extended < leaf) {
+            return false;
+        }
+    } else if (eax < leaf) {
+        return false;
+    }
+
+    std::vector<CacheLevel> levels;
+    for (unsigned subleaf = 0; subleaf < 16; ++subleaf) {
+        __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+        unsigned cache_type = eax & 0x1F;
+        if (cache_type == 0) {
+            break;
+        }
+        CacheLevel cache;
+        cache.level = static_cast<int>((eax >> 5) & 0x7);
+        cache.type = cache_type == 1 ? "Data" : cache_type == 2 ? "Instruction" : "Unified";
+        size_t ways = ((ebx >> 22) & 0x3FF) + 1;
+        size_t partitions = ((ebx >> 12) & 0x3FF) + 1;
+        size_t line = (ebx & 0xFFF) + 1;
+        size_t sets = static_cast<size_t>(ecx) + 1;
+        cache.size_bytes = ways * partitions * line * sets;
+        cache.line_size = line;
+        cache.associativity = (eax & (1u << 9)) ? -1 : static_cast<int>(ways);
+        cache.sharing_cpus = static_cast<int>(((eax >> 14) & 0xFFF) + 1);
+        levels.push_back(cache);
+    }
+    if (levels.empty()) {
+        return false;
+    }
+    sortLevels(levels);
+    topology.levels = levels;
+    topology.source = "cpuid";
+    return true;
+#else
+    (void)topology;
+    return false;
+#endif
+}
+
+inline bool detectFromSysctl(CacheTopology& topology) {
+#ifdef __APPLE__
+    auto query = [](const char* name) -> size_t {
+        int64_t value = 0;
+        size_t size = sizeof(value);
+        return sysctlbyname(name, &value, &size, nullptr, 0) == 0 ? static_cast<size_t>(value) : 0;
+    };
+    size_t line = query("hw.cachelinesize");
+    std::vector<CacheLevel> levels;
+    auto add = [&](int level, const char* type, const char* name) {
+        size_t size = query(name);
+        if (size > 0) {
+            CacheLevel cache;
+            cache.level = level;
+            cache.type = type;
+            cache.size_bytes = size;
+            cache.line_size = line;
+            levels.push_back(cache);
+        }
+    };
+    add(1, "Data", "hw.l1dcachesize");
+    add(1, "Instruction", "hw.l1icachesize");
+    add(2, "Unified", "hw.l2cachesize");
+    add(3, "Unified", "hw.l3cachesize");
+    if (levels.empty()) {
+        return false;
+    }
+    sortLevels(levels);
+    topology.levels = levels;
+    topology.source = "sysctl";
+    return true;
+#else
+    (void)topology;
+    return false;
+#endif
+}
+
+inline CacheTopology detectCacheTopology() {
+    CacheTopology topology;
+    if (!detectFromSysfs(topology) && !detectFromCpuid(topology) && !detectFromSysctl(topology)) {
+        topology.source = "defaults";
+        topology.levels = {
+            {1, "Data", 32 * 1024, 64, 8, "", 1, 0},
+            {2, "Unified", 256 * 1024, 64, 8, "", 1, 0},
+            {3, "Unified", 8 * 1024 * 1024, 64, 16, "", 0, 0},
+        };
+    }
+    const CacheLevel* l1 = topology.dataCache(1);
+    topology.line_size = l1 && l1->line_size > 0 ? l1->line_size : 64;
+    return topology;
+}
+
+} // namespace detail
+
+// Detected once per process
+inline const CacheTopology& cacheTopology() {
+    static const CacheTopology topology = detail::detectCacheTopology();
+    return topology;
+}
+
+// One line per cache level, for the demos' headers
+inline std::string describeCacheTopology(const CacheTopology& topology) {
+    std::ostringstream out;
+    out << "Cache topology (" << topology.source << "), line size " << topology.line_size << " B\n";
+    for (const auto& cache : topology.levels) {
+        out << "  L" << cache.level << " " << cache.type << ": " << cache.size_bytes / 1024 << " KB";
+        if (cache.associativity > 0) {
+            out << ", " << cache.associativity << "-way";
+        } else if (cache.associativity < 0) {
+            out << ", fully associative";
+        }
+        if (!cache.shared_cpu_list.empty()) {
+            out << ", shared by CPUs " << cache.shared_cpu_list;
+        } else if (cache.sharing_cpus > 0) {
+            out << ", shared by up to " << cache.sharing_cpus << " CPUs";
+        }
+        if (cache.instances > 0) {
+            out << " (" << cache.instances << " instance" << (cache.instances == 1 ? "" : "s") << ")";
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+} // namespace hpc
@@ -0,0 +1,287 @@
+#pragma once
+
+// Gather engine for random-access reads: out[i] = table[indices[i]], or the
+// sum of those values.
+//
+// A plain loop over data[indices[i]] issues one independent load per
+// element, but the out-of-order window only holds a few of them, so
+// throughput is bounded by DRAM latency / (misses in flight). The
+// strategies here raise the number of misses in flight or cut their cost:
+//
+//   Direct        - the plain loop, the baseline
+//   Prefetch      - software prefetch of table[indices[i + distance]]
+//                   while loading table[indices[i]]; distance should cover
+//                   latency / time per element (32-64 on current cores)
+//   GroupPrefetch - prefetch a whole group of group_size addresses, then
+//                   load the previous group: misses are issued back to back
+//                   instead of interleaved with the dependent adds
+//   PageBucketed  - partition the requests by region_bytes slice of the
+//                   table first (a whole number of pages, at most half an
+//                   L2), then gather with Prefetch: each slice is visited
+//                   once, so its pages and lines are fetched once and reused
+//                   from L2 instead of re-missing in the TLB and DRAM. Pays
+//                   an O(n) partition pass; worthwhile when the table is far
+//                   larger than the LLC and lookups per slice are many
+//   Hardware      - AVX2 / AVX-512 gather instructions (4-byte elements
+//                   only, otherwise Prefetch); each gather still waits for
+//                   its slowest lane, so it mainly saves instructions
+//
+// gatherSum() is order-independent and is what lookup-heavy reductions
+// (hash-join probe counts, histogram lookups) need; gather() keeps output
+// order, PageBucketed then scatters results back to their positions.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace hpc {
+
+enum class GatherStrategy { Direct, Prefetch, GroupPrefetch, PageBucketed, Hardware };
+
+#if defined(__AVX512F__)
+constexpr const char* GATHER_HARDWARE_NAME = "AVX-512 vpgather";
+#elif defined(__AVX2__)
+constexpr const char* GATHER_HARDWARE_NAME = "AVX2 vpgather";
+#else
+constexpr const char* GATHER_HARDWARE_NAME = "none (software prefetch)";
+#endif
+
+struct GatherOptions {
+    GatherStrategy strategy = GatherStrategy::Prefetch;
+    size_t distance = 48;        // Prefetch / PageBucketed: elements ahead
+    size_t group_size = 32;      // GroupPrefetch: addresses per group
+    size_t region_bytes = 256 * 1024;  // PageBucketed: table slice per bucket
+};
+
+inline const char* gatherStrategyName(GatherStrategy strategy) {
+    switch (strategy) {
+        case GatherStrategy::Direct: return "direct";
+        case GatherStrategy::Prefetch: return "prefetch";
+        case GatherStrategy::GroupPrefetch: return "group prefetch";
+        case GatherStrategy::PageBucketed: return "page bucketed";
+        case GatherStrategy::Hardware: return "hardware gather";
+    }
+    return "unknown";
+}
+
+namespace detail {
+
+inline void prefetchRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+// Visits (position, table[indices[position]]) for every position with the
+// software strategies; visit is inlined into the gather loop
+template <typename T, typename Index, typename Visit>
+inline void gatherVisit(const T* table, const Index* indices, size_t n,
+                        GatherStrategy strategy, const GatherOptions& options, Visit&& visit) {
+    switch (strategy) {
+        case GatherStrategy::Direct:
+            for (size_t i = 0; i < n; ++i) {
+                visit(i, table[indices[i]]);
+            }
+            return;
+
+        case GatherStrategy::GroupPrefetch: {
+            const size_t group = std::max<size_t>(1, options.group_size);
+            size_t issued = std::min(group, n);
+            for (size_t i = 0; i < issued; ++i) {
+                prefetchRead(table + indices[i]);
+            }
+            for (size_t begin = 0; begin < n; begin += group) {
+                // Issue the next group's misses, then consume this group,
+                // whose lines have had a full group's time to arrive
+                const size_t next_end = std::min(issued + group, n);
+                for (size_t i = issued; i < next_end; ++i) {
+                    prefetchRead(table + indices[i]);
+                }
+                issued = next_end;
+                const size_t end = std::min(begin + group, n);
+                for (size_t i = begin; i < end; ++i) {
+                    visit(i, table[indices[i]]);
+                }
+            }
+            return;
+        }
+
+        default: {
+            const size_t distance = std::min(options.distance, n);
+            const size_t steady = n - distance;
+            for (size_t i = 0; i < distance; ++i) {
+                prefetchRead(table + indices[i]);
+            }
+            for (size_t i = 0; i < steady; ++i) {
+                prefetchRead(table + indices[i + distance]);
+                visit(i, table[indices[i]]);
+            }
+            for (size_t i = steady; i < n; ++i) {
+                visit(i, table[indices[i]]);
+            }
+            return;
+        }
+    }
+}
+
+// Stable counting sort of the requests by table slice: sorted receives the
+// indices slice by slice and, if positions is non-null, the request
+// position each one came from. The slice grows if needed to keep the
+// histogram within L1.
+template <typename Index>
+inline void partitionByRegion(const Index* indices, size_t n, size_t element_bytes, size_t region_bytes,
+                              Index* sorted, uint32_t* positions) {
+    constexpr size_t MAX_BUCKETS = 4096;
+    Index max_index = 0;
+    for (size_t i = 0; i < n; ++i) {
+        max_index = std::max(max_index, indices[i]);
+    }
+    size_t per_region = std::max<size_t>(1, region_bytes / element_bytes);
+    while (static_cast<size_t>(max_index) / per_region + 1 > MAX_BUCKETS) {
+        per_region *= 2;
+    }
+    const size_t buckets = static_cast<size_t>(max_index) / per_region + 1;
+
+    std::vector<size_t> start(buckets + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        ++start[static_cast<size_t>(indices[i]) / per_region + 1];
+    }
+    for (size_t b = 0; b < buckets; ++b) {
+        start[b + 1] += start[b];
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const size_t slot = start[static_cast<size_t>(indices[i]) / per_region]++;
+        sorted[slot] = indices[i];
+        if (positions) {
+            positions[slot] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+#if defined(__AVX2__)
+// Hardware gather is provided for 4-byte elements with 32- or 64-bit
+// indices; everything else takes the software path
+template <typename T, typename Index>
+constexpr bool hasHardwareGather =
+    sizeof(T) == 4 && std::is_integral_v<Index> && (sizeof(Index) == 4 || sizeof(Index) == 8);
+
+// out[i] = table[indices[i]] for i in [0, n) with vector gathers, 4-byte
+// elements handled as int32 bit patterns
+template <typename Index>
+inline void hardwareGather(const int32_t* table, const Index* indices, size_t n, int32_t* out) {
+    size_t i = 0;
+#if defined(__AVX512F__)
+    // Masked forms: GCC warns that the unmasked ones read an uninitialized
+    // pass-through source
+    if constexpr (sizeof(Index) == 4) {
+        for (; i + 16 <= n; i += 16) {
+            __m512i idx = _mm512_loadu_si512(indices + i);
+            __m512i values = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, idx, table, 4);
+            _mm512_storeu_si512(out + i, values);
+        }
+    } else {
+        for (; i + 8 <= n; i += 8) {
+            __m512i idx = _mm512_loadu_si512(indices + i);
+            __m256i values = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), 0xFF, idx, table, 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), values);
+        }
+    }
+#else
+    if constexpr (sizeof(Index) == 4) {
+        for (; i + 8 <= n; i += 8) {
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_i32gather_epi32(table, idx, 4));
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                             _mm256_i64gather_epi32(reinterpret_cast<const int*>(table), idx, 4));
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = table[indices[i]];
+    }
+}
+#else
+template <typename T, typename Index>
+constexpr bool hasHardwareGather = false;
+#endif
+
+} // namespace detail
+
+// out[i] = table[indices[i]] for i in [0, n)
+template <typename T, typename Index>
+inline void gather(const T* table, const Index* indices, size_t n, T* out,
+                   const GatherOptions& options = {}) {
+    GatherStrategy strategy = options.strategy;
+    if (strategy == GatherStrategy::Hardware) {
+#if defined(__AVX2__)
+        if constexpr (detail::hasHardwareGather<T, Index>) {
+            detail::hardwareGather(reinterpret_cast<const int32_t*>(table), indices, n,
+                                   reinterpret_cast<int32_t*>(out));
+            return;
+        }
+#endif
+        strategy = GatherStrategy::Prefetch;
+    }
+    if (strategy == GatherStrategy::PageBucketed) {
+        std::vector<Index> sorted(n);
+        std::vector<uint32_t> positions(n);
+        detail::partitionByRegion(indices, n, sizeof(T), options.region_bytes, sorted.data(), positions.data());
+        detail::gatherVisit(table, sorted.data(), n, GatherStrategy::Prefetch, options,
+                            [&](size_t k, const T& value) { out[positions[k]] = value; });
+        return;
+    }
+    detail::gatherVisit(table, indices, n, strategy, options,
+                        [out](size_t i, const T& value) { out[i] = value; });
+}
+
+// Sum of table[indices[i]] for i in [0, n), accumulated in Acc
+template <typename Acc, typename T, typename Index>
+inline Acc gatherSum(const T* table, const Index* indices, size_t n, const GatherOptions& options = {}) {
+    GatherStrategy strategy = options.strategy;
+    if (strategy == GatherStrategy::Hardware) {
+#if defined(__AVX2__)
+        if constexpr (detail::hasHardwareGather<T, Index>) {
+            // Gather a cache-resident block, then reduce it
+            constexpr size_t BLOCK = 1024;
+            alignas(64) T block[BLOCK];
+            Acc sum = 0;
+            for (size_t begin = 0; begin < n; begin += BLOCK) {
+                const size_t count = std::min(BLOCK, n - begin);
+                detail::hardwareGather(reinterpret_cast<const int32_t*>(table), indices + begin, count,
+                                       reinterpret_cast<int32_t*>(block));
+                for (size_t i = 0; i < count; ++i) {
+                    sum += block[i];
+                }
+            }
+            return sum;
+        }
+#endif
+        strategy = GatherStrategy::Prefetch;
+    }
+    Acc sum = 0;
+    if (strategy == GatherStrategy::PageBucketed) {
+        std::vector<Index> sorted(n);
+        detail::partitionByRegion(indices, n, sizeof(T), options.region_bytes, sorted.data(),
+                                  static_cast<uint32_t*>(nullptr));
+        detail::gatherVisit(table, sorted.data(), n, GatherStrategy::Prefetch, options,
+                            [&sum](size_t, const T& value) { sum += value; });
+        return sum;
+    }
+    detail::gatherVisit(table, indices, n, strategy, options,
+                        [&sum](size_t, const T& value) { sum += value; });
+    return sum;
+}
+
+} // namespace hpc
@@ -0,0 +1,425 @@
+#pragma once
+
+// Packed-panel GEMM engine (GotoBLAS/BLIS structure).
+//
+//   for jc in N step nc          B panel  kc x nc  -> lives in L3
+//     for pc in K step kc        pack B panel into NR-wide micro-panels
+//       for ic in M step mc      A panel  mc x kc  -> lives in L2
+//         pack A panel into MR-tall micro-panels
+//         for jr in nc step NR   B micro-panel kc x NR -> lives in L1
+//           for ir in mc step MR
+//             MR x NR register tile: C += A_micro * B_micro
+//
+// The register tile is chosen at compile time: AVX-512 (12x32), AVX2/FMA
+// (6x16) or a portable scalar kernel (4x4). All matrices are row-major with
+// explicit leading dimensions, so both the AlignedMatrix demo and raw
+// float* buffers can call it.
+//
+// gemmParallel() spreads the (ic, jr) output tiles of each kc step over
+// OpenMP threads. The kc x nc B panel is packed once, cooperatively, into a
+// shared buffer; each thread packs only the A rows of the tiles it owns.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace hpc {
+
+#if defined(__AVX512F__)
+constexpr int GEMM_MR = 12;
+constexpr int GEMM_NR = 32;
+constexpr const char* GEMM_KERNEL_NAME = "AVX-512 12x32";
+#elif defined(__AVX2__) && defined(__FMA__)
+constexpr int GEMM_MR = 6;
+constexpr int GEMM_NR = 16;
+constexpr const char* GEMM_KERNEL_NAME = "AVX2/FMA 6x16";
+#else
+constexpr int GEMM_MR = 4;
+constexpr int GEMM_NR = 4;
+constexpr const char* GEMM_KERNEL_NAME = "scalar 4x4";
+#endif
+
+// Cache blocking parameters for gemm(). The drivers round mc and nc up to
+// multiples of MR / NR (see roundGemmBlocking), so any positive values work.
+struct GemmBlocking {
+    int mc = 144;
+    int kc = 256;
+    int nc = 4096;
+};
+
+// Derive blocking from cache capacities (bytes): a kc x NR micro-panel of B
+// takes half of L1, an mc x kc panel of A half of L2, and a kc x nc panel of
+// B half of L3.
+inline GemmBlocking gemmBlockingFor(size_t l1_bytes, size_t l2_bytes, size_t l3_bytes) {
+    GemmBlocking blocking;
+    int kc = static_cast<int>(l1_bytes / 2 / (GEMM_NR * sizeof(float)));
+    blocking.kc = std::clamp(kc / 8 * 8, 64, 1024);
+    int mc = static_cast<int>(l2_bytes / 2 / (blocking.kc * sizeof(float)));
+    blocking.mc = std::clamp(mc / GEMM_MR * GEMM_MR, GEMM_MR, 960);
+    int nc = static_cast<int>(l3_bytes / 2 / (blocking.kc * sizeof(float)));
+    blocking.nc = std::clamp(nc / GEMM_NR * GEMM_NR, GEMM_NR, 8192);
+    return blocking;
+}
+
+// blocking with mc / nc rounded up to whole MR / NR micro-panels, which is
+// what packA / packB fill (zero-padded), and every value at least 1. Packed
+// buffers are sized from the rounded values.
+inline GemmBlocking roundGemmBlocking(GemmBlocking blocking) {
+    blocking.mc = (std::max(blocking.mc, 1) + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    blocking.nc = (std::max(blocking.nc, 1) + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    blocking.kc = std::max(blocking.kc, 1);
+    return blocking;
+}
+
+namespace detail {
+
+constexpr size_t GEMM_ALIGNMENT = 64;
+
+struct GemmFree {
+    void operator()(float* p) const { std::free(p); }
+};
+using GemmBuffer = std::unique_ptr<float[], GemmFree>;
+
+inline GemmBuffer allocateGemmBuffer(size_t count) {
+    size_t bytes = (count * sizeof(float) + GEMM_ALIGNMENT - 1) / GEMM_ALIGNMENT * GEMM_ALIGNMENT;
+    void* p = std::aligned_alloc(GEMM_ALIGNMENT, std::max(bytes, GEMM_ALIGNMENT));
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return GemmBuffer(static_cast<float*>(p));
+}
+
+// Pack an mc x kc block of A into MR-row micro-panels: for each micro-panel,
+// kc columns of MR contiguous values. Rows past mc are zero-filled.
+inline void packA(int mc, int kc, const float* A, int lda, float* packed) {
+    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+        int rows = std::min(GEMM_MR, mc - ir);
+        for (int p = 0; p < kc; ++p) {
+            for (int i = 0; i < rows; ++i) {
+                packed[i] = A[static_cast<size_t>(ir + i) * lda + p];
+            }
+            for (int i = rows; i < GEMM_MR; ++i) {
+                packed[i] = 0.0f;
+            }
+            packed += GEMM_MR;
+        }
+    }
+}
+
+// Pack a kc x nc block of B into NR-column micro-panels: for each
+// micro-panel, kc rows of NR contiguous values. Columns past nc are zero-filled.
+inline void packB(int kc, int nc, const float* B, int ldb, float* packed) {
+    for (int jr = 0; jr < nc; jr += GEMM_NR) {
+        int cols = std::min(GEMM_NR, nc - jr);
+        for (int p = 0; p < kc; ++p) {
+            const float* row = B + static_cast<size_t>(p) * ldb + jr;
+            for (int j = 0; j < cols; ++j) {
+                packed[j] = row[j];
+            }
+            for (int j = cols; j < GEMM_NR; ++j) {
+                packed[j] = 0.0f;
+            }
+            packed += GEMM_NR;
+        }
+    }
+}
+
+// C (MR x NR, leading dimension ldc) = beta * C + A_micro * B_micro.
+// beta is 0 or 1; with beta == 0 C is never read.
+inline void microKernel(int kc, const float* a, const float* b, float* c, int ldc, float beta) {
+#if defined(__AVX512F__)
+    __m512 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+    for (int p = 0; p < kc; ++p) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+#pragma GCC unroll 12
+        for (int i = 0; i < GEMM_MR; ++i) {
+            __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (beta != 0.0f) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(row));
+            acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(row + 16));
+        }
+        _mm512_storeu_ps(row, acc[i][0]);
+        _mm512_storeu_ps(row + 16, acc[i][1]);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int p = 0; p < kc; ++p) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+        for (int i = 0; i < GEMM_MR; ++i) {
+            __m256 ai = _mm256_broadcast_ss(a + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (beta != 0.0f) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+        }
+        _mm256_storeu_ps(row, acc[i][0]);
+        _mm256_storeu_ps(row + 8, acc[i][1]);
+    }
+#else
+    float acc[GEMM_MR][GEMM_NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int i = 0; i < GEMM_MR; ++i) {
+            for (int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] += a[i] * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        for (int j = 0; j < GEMM_NR; ++j) {
+            row[j] = (beta != 0.0f ? row[j] : 0.0f) + acc[i][j];
+        }
+    }
+#endif
+}
+
+// Run the register tile over one packed mc x kc A panel and kc x nc B panel.
+// Partial tiles at the right/bottom edge go through a scratch tile so the
+// microkernel never touches memory outside C.
+inline void macroKernel(int mc, int nc, int kc, const float* packedA, const float* packedB,
+                        float* C, int ldc, float beta) {
+    alignas(GEMM_ALIGNMENT) float tile[GEMM_MR * GEMM_NR];
+    for (int jr = 0; jr < nc; jr += GEMM_NR) {
+        int cols = std::min(GEMM_NR, nc - jr);
+        const float* b = packedB + static_cast<size_t>(jr) * kc;
+        for (int ir = 0; ir < mc; ir += GEMM_MR) {
+            int rows = std::min(GEMM_MR, mc - ir);
+            const float* a = packedA + static_cast<size_t>(ir) * kc;
+            float* c = C + static_cast<size_t>(ir) * ldc + jr;
+            if (rows == GEMM_MR && cols == GEMM_NR) {
+                microKernel(kc, a, b, c, ldc, beta);
+            } else {
+                microKernel(kc, a, b, tile, GEMM_NR, 0.0f);
+                for (int i = 0; i < rows; ++i) {
+                    float* row = c + static_cast<size_t>(i) * ldc;
+                    for (int j = 0; j < cols; ++j) {
+                        row[j] = (beta != 0.0f ? row[j] : 0.0f) + tile[i * GEMM_NR + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+// C (M x N) = A (M x K) * B (K x N), or C += A * B when accumulate is set.
+// All matrices are row-major; lda/ldb/ldc are row pitches in elements.
+inline void gemm(int M, int N, int K,
+                 const float* A, int lda,
+                 const float* B, int ldb,
+                 float* C, int ldc,
+                 bool accumulate = false,
+                 const GemmBlocking& requested = GemmBlocking()) {
+    const GemmBlocking blocking = roundGemmBlocking(requested);
+    if (M <= 0 || N <= 0) {
+        return;
+    }
+    if (K <= 0) {
+        if (!accumulate) {
+            for (int i = 0; i < M; ++i) {
+                std::fill_n(C + static_cast<size_t>(i) * ldc, N, 0.0f);
+            }
+        }
+        return;
+    }
+
+    const int mc_max = std::min(blocking.mc, (M + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    const int nc_max = std::min(blocking.nc, (N + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    const int kc_max = std::min(blocking.kc, K);
+    auto packedA = detail::allocateGemmBuffer(static_cast<size_t>(mc_max) * kc_max);
+    auto packedB = detail::allocateGemmBuffer(static_cast<size_t>(nc_max) * kc_max);
+
+    for (int jc = 0; jc < N; jc += blocking.nc) {
+        int nc = std::min(blocking.nc, N - jc);
+        for (int pc = 0; pc < K; pc += blocking.kc) {
+            int kc = std::min(blocking.kc, K - pc);
+            float beta = (pc == 0 && !accumulate) ? 0.0f : 1.0f;
+            detail::packB(kc, nc, B + static_cast<size_t>(pc) * ldb + jc, ldb, packedB.get());
+            for (int ic = 0; ic < M; ic += blocking.mc) {
+                int mc = std::min(blocking.mc, M - ic);
+                detail::packA(mc, kc, A + static_cast<size_t>(ic) * lda + pc, lda, packedA.get());
+                detail::macroKernel(mc, nc, kc, packedA.get(), packedB.get(),
+                                    C + static_cast<size_t>(ic) * ldc + jc, ldc, beta);
+            }
+        }
+    }
+}
+
+// How gemmParallel() assigns output tiles to threads
+enum class GemmSchedule {
+    Static,         // contiguous runs of tiles per thread (omp schedule(static))
+    Dynamic,        // tiles handed out one at a time (omp schedule(dynamic, 1))
+    BlockCyclic2D   // threads form a pr x pc grid; tile (i, j) -> (i % pr, j % pc)
+};
+
+inline const char* gemmScheduleName(GemmSchedule schedule) {
+    switch (schedule) {
+        case GemmSchedule::Static: return "static";
+        case GemmSchedule::Dynamic: return "dynamic";
+        case GemmSchedule::BlockCyclic2D: return "block-cyclic-2d";
+    }
+    return "unknown";
+}
+
+// Multithreaded C = A * B (or C += A * B). num_threads <= 0 uses
+// omp_get_max_threads(). Without OpenMP this is gemm().
+inline void gemmParallel(int M, int N, int K,
+                         const float* A, int lda,
+                         const float* B, int ldb,
+                         float* C, int ldc,
+                         GemmSchedule schedule = GemmSchedule::Static,
+                         int num_threads = 0,
+                         bool accumulate = false,
+                         const GemmBlocking& requested = GemmBlocking()) {
+    const GemmBlocking blocking = roundGemmBlocking(requested);
+#ifndef _OPENMP
+    (void)schedule;
+    (void)num_threads;
+    gemm(M, N, K, A, lda, B, ldb, C, ldc, accumulate, blocking);
+#else
+    int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+    if (M <= 0 || N <= 0 || K <= 0 || threads == 1) {
+        gemm(M, N, K, A, lda, B, ldb, C, ldc, accumulate, blocking);
+        return;
+    }
+
+    const int nc_max = std::min(blocking.nc, (N + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    const int kc_max = std::min(blocking.kc, K);
+
+    // Output tiles are tile_m rows by tile_n columns. Shrink tile_m until
+    // there are a few tiles per thread so small problems still load-balance.
+    const int tile_n = std::min(nc_max, GEMM_NR * 4);
+    int tile_m = std::min(blocking.mc, (M + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    auto tileCount = [&](int tm) {
+        return ((M + tm - 1) / tm) * ((nc_max + tile_n - 1) / tile_n);
+    };
+    while (tile_m > GEMM_MR && tileCount(tile_m) < 4 * threads) {
+        tile_m = std::max(GEMM_MR, tile_m / 2 / GEMM_MR * GEMM_MR);
+    }
+
+    // Thread grid for the block-cyclic schedule: pr x pc with pr <= pc
+    int grid_rows = 1;
+    for (int r = 1; r * r <= threads; ++r) {
+        if (threads % r == 0) {
+            grid_rows = r;
+        }
+    }
+    const int grid_cols = threads / grid_rows;
+
+    auto packedB = detail::allocateGemmBuffer(static_cast<size_t>(nc_max) * kc_max);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        auto packedA = detail::allocateGemmBuffer(static_cast<size_t>(tile_m) * kc_max);
+        const int tid = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+
+        for (int jc = 0; jc < N; jc += blocking.nc) {
+            const int nc = std::min(blocking.nc, N - jc);
+            const int row_tiles = (M + tile_m - 1) / tile_m;
+            const int col_tiles = (nc + tile_n - 1) / tile_n;
+            const int tiles = row_tiles * col_tiles;
+
+            for (int pc = 0; pc < K; pc += blocking.kc) {
+                const int kc = std::min(blocking.kc, K - pc);
+                const float beta = (pc == 0 && !accumulate) ? 0.0f : 1.0f;
+
+                // Shared B panel: every thread packs a slice of micro-panels
+                #pragma omp for schedule(static)
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    detail::packB(kc, std::min(GEMM_NR, nc - jr),
+                                  B + static_cast<size_t>(pc) * ldb + jc + jr, ldb,
+                                  packedB.get() + static_cast<size_t>(jr) * kc);
+                }
+
+                // Consecutive tiles of one thread usually share a row block,
+                // so the packed A rows are only rebuilt when ti changes.
+                int packed_ti = -1;
+                auto runTile = [&](int ti, int tj) {
+                    const int ic = ti * tile_m;
+                    const int rows = std::min(tile_m, M - ic);
+                    const int jt = tj * tile_n;
+                    const int cols = std::min(tile_n, nc - jt);
+                    if (ti != packed_ti) {
+                        detail::packA(rows, kc, A + static_cast<size_t>(ic) * lda + pc, lda,
+                                      packedA.get());
+                        packed_ti = ti;
+                    }
+                    detail::macroKernel(rows, cols, kc, packedA.get(),
+                                        packedB.get() + static_cast<size_t>(jt) * kc,
+                                        C + static_cast<size_t>(ic) * ldc + jc + jt, ldc, beta);
+                };
+
+                // Each branch ends in a barrier so packedB is not repacked
+                // while another thread is still reading it.
+                if (schedule == GemmSchedule::Static) {
+                    #pragma omp for schedule(static)
+                    for (int t = 0; t < tiles; ++t) {
+                        runTile(t / col_tiles, t % col_tiles);
+                    }
+                } else if (schedule == GemmSchedule::Dynamic) {
+                    #pragma omp for schedule(dynamic, 1)
+                    for (int t = 0; t < tiles; ++t) {
+                        runTile(t / col_tiles, t % col_tiles);
+                    }
+                } else {
+                    if (team == grid_rows * grid_cols) {
+                        for (int ti = tid / grid_cols; ti < row_tiles; ti += grid_rows) {
+                            for (int tj = tid % grid_cols; tj < col_tiles; tj += grid_cols) {
+                                runTile(ti, tj);
+                            }
+                        }
+                    } else {
+                        // Runtime gave us fewer threads than requested: 1D cyclic
+                        for (int t = tid; t < tiles; t += team) {
+                            runTile(t / col_tiles, t % col_tiles);
+                        }
+                    }
+                    #pragma omp barrier
+                }
+            }
+        }
+    }
+#endif
+}
+
+} // namespace hpc
@@ -0,0 +1,470 @@
+#pragma once
+
+// Reduced-precision GEMM: bf16 x bf16 -> fp32 and int8 x int8 -> int32.
+//
+// Same loop nest and register tile (GEMM_MR x GEMM_NR) as gemm.h, but the
+// packed panels interleave k so one 32-bit lane holds several consecutive k
+// values of one row/column, which is the operand layout the dot-product
+// instructions want:
+//
+//   bf16  pairs of k   ->  vdpbf16ps  (AVX512_BF16):  c += a0*b0 + a1*b1
+//   int8  quads of k   ->  vpdpbusd   (AVX512_VNNI):  c += sum of 4 u8*s8
+//
+// vpdpbusd multiplies unsigned by signed bytes, so A is packed as a + 128
+// and the extra 128 * sum_k(b) per column is subtracted when the tile is
+// stored. Without the ISA extensions k is not interleaved (group of 1) and
+// the kernel widens each element to fp32 / int32 instead: explicit AVX2 code,
+// or a portable loop shaped like the fp32 kernel so the compiler vectorizes
+// it. Results match up to fp32 summation order for bf16 and exactly for int8.
+//
+// Operands use half (bf16) or a quarter (int8) of the fp32 bytes, so a
+// bandwidth-bound multiply moves correspondingly less data. Conversion
+// helpers: floatToBf16 rounds to nearest even; quantizeInt8 is symmetric
+// per-tensor (value ~= scale * q, q in [-127, 127]).
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "gemm.h"
+
+namespace hpc {
+
+// k values interleaved per 32-bit lane of the packed panels
+#if defined(__AVX512BF16__)
+constexpr int GEMM_BF16_GROUP = 2;
+constexpr const char* GEMM_BF16_KERNEL_NAME = "AVX512-BF16 vdpbf16ps";
+#else
+constexpr int GEMM_BF16_GROUP = 1;
+constexpr const char* GEMM_BF16_KERNEL_NAME = "emulated (widen to fp32)";
+#endif
+
+#if defined(__AVX512VNNI__)
+constexpr int GEMM_INT8_GROUP = 4;
+constexpr const char* GEMM_INT8_KERNEL_NAME = "AVX512-VNNI vpdpbusd";
+#else
+constexpr int GEMM_INT8_GROUP = 1;
+constexpr const char* GEMM_INT8_KERNEL_NAME = "emulated (widen to int32)";
+#endif
+
+// bf16 is stored as the upper 16 bits of an IEEE float
+inline uint16_t floatToBf16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40);  // quiet NaN
+    }
+    bits += 0x7FFFu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bf16ToFloat(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Convert a rows x cols fp32 matrix to bf16
+inline void convertToBf16(int rows, int cols, const float* src, int lds, uint16_t* dst, int ldd) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            dst[static_cast<size_t>(i) * ldd + j] = floatToBf16(src[static_cast<size_t>(i) * lds + j]);
+        }
+    }
+}
+
+// Quantize a rows x cols fp32 matrix to int8 with one symmetric scale.
+// Returns the scale: src ~= scale * dst.
+inline float quantizeInt8(int rows, int cols, const float* src, int lds, int8_t* dst, int ldd) {
+    float max_abs = 0.0f;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            max_abs = std::max(max_abs, std::fabs(src[static_cast<size_t>(i) * lds + j]));
+        }
+    }
+    float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+    float inverse = 1.0f / scale;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            float q = std::nearbyint(src[static_cast<size_t>(i) * lds + j] * inverse);
+            dst[static_cast<size_t>(i) * ldd + j] = static_cast<int8_t>(std::clamp(q, -127.0f, 127.0f));
+        }
+    }
+    return scale;
+}
+
+namespace detail {
+
+template <typename T>
+struct LowpFree {
+    void operator()(T* p) const { std::free(p); }
+};
+template <typename T>
+using LowpBuffer = std::unique_ptr<T[], LowpFree<T>>;
+
+template <typename T>
+inline LowpBuffer<T> allocateLowpBuffer(size_t count) {
+    size_t bytes = (count * sizeof(T) + GEMM_ALIGNMENT - 1) / GEMM_ALIGNMENT * GEMM_ALIGNMENT;
+    void* p = std::aligned_alloc(GEMM_ALIGNMENT, std::max(bytes, GEMM_ALIGNMENT));
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return LowpBuffer<T>(static_cast<T*>(p));
+}
+
+// Pack an mc x kc block of A into MR-row micro-panels with k interleaved in
+// groups of G: for each group, MR rows of G consecutive k values.
+// kc_padded is kc rounded up to G; padding is filled with convert(0).
+template <int G, typename Src, typename Dst, typename Convert>
+inline void packALowp(int mc, int kc, int kc_padded, const Src* A, int lda, Dst* packed,
+                      Convert convert) {
+    const Dst zero = convert(Src(0));
+    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+        int rows = std::min(GEMM_MR, mc - ir);
+        for (int p = 0; p < kc_padded; p += G) {
+            for (int i = 0; i < GEMM_MR; ++i) {
+                for (int g = 0; g < G; ++g) {
+                    packed[i * G + g] = (i < rows && p + g < kc)
+                        ? convert(A[static_cast<size_t>(ir + i) * lda + p + g]) : zero;
+                }
+            }
+            packed += GEMM_MR * G;
+        }
+    }
+}
+
+// Pack a kc x nc block of B into NR-column micro-panels with k interleaved in
+// groups of G: for each group, NR columns of G consecutive k values.
+// Padding is zero.
+template <int G, typename T>
+inline void packBLowp(int kc, int nc, int kc_padded, const T* B, int ldb, T* packed) {
+    for (int jr = 0; jr < nc; jr += GEMM_NR) {
+        int cols = std::min(GEMM_NR, nc - jr);
+        for (int p = 0; p < kc_padded; p += G) {
+            for (int j = 0; j < GEMM_NR; ++j) {
+                for (int g = 0; g < G; ++g) {
+                    packed[j * G + g] = (j < cols && p + g < kc)
+                        ? B[static_cast<size_t>(p + g) * ldb + jr + j] : T(0);
+                }
+            }
+            packed += GEMM_NR * G;
+        }
+    }
+}
+
+// 128 * column sums of a kc x nc block of B: the correction for packing A
+// as unsigned bytes (a + 128). Columns past nc are zero.
+inline void int8Compensation(int kc, int nc, const int8_t* B, int ldb, int32_t* comp) {
+    const int nc_padded = (nc + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    std::fill_n(comp, nc_padded, 0);
+    for (int p = 0; p < kc; ++p) {
+        const int8_t* row = B + static_cast<size_t>(p) * ldb;
+        for (int j = 0; j < nc; ++j) {
+            comp[j] += row[j];
+        }
+    }
+    for (int j = 0; j < nc; ++j) {
+        comp[j] *= 128;
+    }
+}
+
+// C (MR x NR) = beta * C + A_micro * B_micro, k in groups of GEMM_BF16_GROUP
+inline void microKernelBf16(int kc_padded, const uint16_t* a, const uint16_t* b,
+                            float* c, int ldc, float beta) {
+#if defined(__AVX512BF16__)
+    static_assert(GEMM_NR == 32, "vdpbf16ps kernel assumes the AVX-512 12x32 tile");
+    __m512 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+    for (int p = 0; p < kc_padded; p += 2) {
+        __m512bh b0 = (__m512bh)_mm512_load_si512(b);
+        __m512bh b1 = (__m512bh)_mm512_load_si512(b + 32);
+#pragma GCC unroll 12
+        for (int i = 0; i < GEMM_MR; ++i) {
+            int32_t pair;
+            std::memcpy(&pair, a + 2 * i, sizeof(pair));
+            __m512bh ai = (__m512bh)_mm512_set1_epi32(pair);
+            acc[i][0] = _mm512_dpbf16_ps(acc[i][0], ai, b0);
+            acc[i][1] = _mm512_dpbf16_ps(acc[i][1], ai, b1);
+        }
+        a += GEMM_MR * 2;
+        b += GEMM_NR * 2;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (beta != 0.0f) {
+            acc[i][0] = _mm512_add_ps(acc[i][0], _mm512_loadu_ps(row));
+            acc[i][1] = _mm512_add_ps(acc[i][1], _mm512_loadu_ps(row + 16));
+        }
+        _mm512_storeu_ps(row, acc[i][0]);
+        _mm512_storeu_ps(row + 16, acc[i][1]);
+    }
+#elif defined(__AVX2__) && defined(__FMA__) && !defined(__AVX512F__)
+    // Widen: bf16 -> fp32 is a 16-bit left shift of the zero-extended value
+    __m256 acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int p = 0; p < kc_padded; ++p) {
+        __m256 b0 = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(b))), 16));
+        __m256 b1 = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(b + 8))), 16));
+#pragma GCC unroll 6
+        for (int i = 0; i < GEMM_MR; ++i) {
+            __m256 ai = _mm256_set1_ps(bf16ToFloat(a[i]));
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        if (beta != 0.0f) {
+            acc[i][0] = _mm256_add_ps(acc[i][0], _mm256_loadu_ps(row));
+            acc[i][1] = _mm256_add_ps(acc[i][1], _mm256_loadu_ps(row + 8));
+        }
+        _mm256_storeu_ps(row, acc[i][0]);
+        _mm256_storeu_ps(row + 8, acc[i][1]);
+    }
+#else
+    float acc[GEMM_MR][GEMM_NR] = {};
+    for (int p = 0; p < kc_padded; ++p) {
+        float bp[GEMM_NR];
+        for (int j = 0; j < GEMM_NR; ++j) {
+            bp[j] = bf16ToFloat(b[j]);
+        }
+        for (int i = 0; i < GEMM_MR; ++i) {
+            float ai = bf16ToFloat(a[i]);
+            for (int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] += ai * bp[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        float* row = c + static_cast<size_t>(i) * ldc;
+        for (int j = 0; j < GEMM_NR; ++j) {
+            row[j] = (beta != 0.0f ? row[j] : 0.0f) + acc[i][j];
+        }
+    }
+#endif
+}
+
+// C (MR x NR) = beta * C + A_micro * B_micro - comp, k in groups of GEMM_INT8_GROUP.
+// a holds u8 (a + 128), b holds s8.
+inline void microKernelInt8(int kc_padded, const uint8_t* a, const int8_t* b, const int32_t* comp,
+                            int32_t* c, int ldc, int beta) {
+#if defined(__AVX512VNNI__)
+    static_assert(GEMM_NR == 32, "vpdpbusd kernel assumes the AVX-512 12x32 tile");
+    __m512i acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm512_setzero_si512();
+        acc[i][1] = _mm512_setzero_si512();
+    }
+    for (int p = 0; p < kc_padded; p += 4) {
+        __m512i b0 = _mm512_load_si512(b);
+        __m512i b1 = _mm512_load_si512(b + 64);
+#pragma GCC unroll 12
+        for (int i = 0; i < GEMM_MR; ++i) {
+            int32_t quad;
+            std::memcpy(&quad, a + 4 * i, sizeof(quad));
+            __m512i ai = _mm512_set1_epi32(quad);
+            acc[i][0] = _mm512_dpbusd_epi32(acc[i][0], ai, b0);
+            acc[i][1] = _mm512_dpbusd_epi32(acc[i][1], ai, b1);
+        }
+        a += GEMM_MR * 4;
+        b += GEMM_NR * 4;
+    }
+    __m512i comp0 = _mm512_loadu_si512(comp);
+    __m512i comp1 = _mm512_loadu_si512(comp + 16);
+    for (int i = 0; i < GEMM_MR; ++i) {
+        int32_t* row = c + static_cast<size_t>(i) * ldc;
+        acc[i][0] = _mm512_sub_epi32(acc[i][0], comp0);
+        acc[i][1] = _mm512_sub_epi32(acc[i][1], comp1);
+        if (beta != 0) {
+            acc[i][0] = _mm512_add_epi32(acc[i][0], _mm512_loadu_si512(row));
+            acc[i][1] = _mm512_add_epi32(acc[i][1], _mm512_loadu_si512(row + 16));
+        }
+        _mm512_storeu_si512(row, acc[i][0]);
+        _mm512_storeu_si512(row + 16, acc[i][1]);
+    }
+#elif defined(__AVX2__) && defined(__FMA__) && !defined(__AVX512F__)
+    // Widen bytes to int32 lanes and multiply-add in 32 bits
+    __m256i acc[GEMM_MR][2];
+    for (int i = 0; i < GEMM_MR; ++i) {
+        acc[i][0] = _mm256_setzero_si256();
+        acc[i][1] = _mm256_setzero_si256();
+    }
+    for (int p = 0; p < kc_padded; ++p) {
+        __m256i b0 = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b)));
+        __m256i b1 = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + 8)));
+#pragma GCC unroll 6
+        for (int i = 0; i < GEMM_MR; ++i) {
+            __m256i ai = _mm256_set1_epi32(a[i]);
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_mullo_epi32(ai, b0));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_mullo_epi32(ai, b1));
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    __m256i comp0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(comp));
+    __m256i comp1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(comp + 8));
+    for (int i = 0; i < GEMM_MR; ++i) {
+        __m256i* row = reinterpret_cast<__m256i*>(c + static_cast<size_t>(i) * ldc);
+        acc[i][0] = _mm256_sub_epi32(acc[i][0], comp0);
+        acc[i][1] = _mm256_sub_epi32(acc[i][1], comp1);
+        if (beta != 0) {
+            acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_loadu_si256(row));
+            acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_loadu_si256(row + 1));
+        }
+        _mm256_storeu_si256(row, acc[i][0]);
+        _mm256_storeu_si256(row + 1, acc[i][1]);
+    }
+#else
+    int32_t acc[GEMM_MR][GEMM_NR] = {};
+    for (int p = 0; p < kc_padded; ++p) {
+        int32_t bp[GEMM_NR];
+        for (int j = 0; j < GEMM_NR; ++j) {
+            bp[j] = b[j];
+        }
+        for (int i = 0; i < GEMM_MR; ++i) {
+            int32_t ai = a[i];
+            for (int j = 0; j < GEMM_NR; ++j) {
+                acc[i][j] += ai * bp[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+    for (int i = 0; i < GEMM_MR; ++i) {
+        int32_t* row = c + static_cast<size_t>(i) * ldc;
+        for (int j = 0; j < GEMM_NR; ++j) {
+            row[j] = (beta != 0 ? row[j] : 0) + acc[i][j] - comp[j];
+        }
+    }
+#endif
+}
+
+// Shared loop nest for both element types. Kernel(a, b, jr, c, ldc, beta)
+// runs one full MR x NR tile; edge tiles go through a scratch tile.
+template <int G, typename APacked, typename BElem, typename CElem,
+          typename PackA, typename PackB, typename Kernel>
+inline void gemmLowpDriver(int M, int N, int K, CElem* C, int ldc, bool accumulate,
+                           const GemmBlocking& requested, PackA packA, PackB packB, Kernel kernel) {
+    const GemmBlocking blocking = roundGemmBlocking(requested);
+    if (M <= 0 || N <= 0) {
+        return;
+    }
+    if (K <= 0) {
+        if (!accumulate) {
+            for (int i = 0; i < M; ++i) {
+                std::fill_n(C + static_cast<size_t>(i) * ldc, N, CElem(0));
+            }
+        }
+        return;
+    }
+
+    // kc must be a whole number of k groups so blocks after the first
+    // start on a group boundary
+    const int kc_block = std::max(G, blocking.kc / G * G);
+    const int mc_max = std::min(blocking.mc, (M + GEMM_MR - 1) / GEMM_MR * GEMM_MR);
+    const int nc_max = std::min(blocking.nc, (N + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    const int kc_max = std::min(kc_block, (K + G - 1) / G * G);
+    auto packedA = allocateLowpBuffer<APacked>(static_cast<size_t>(mc_max) * kc_max);
+    auto packedB = allocateLowpBuffer<BElem>(static_cast<size_t>(nc_max) * kc_max);
+    alignas(GEMM_ALIGNMENT) CElem tile[GEMM_MR * GEMM_NR];
+
+    for (int jc = 0; jc < N; jc += blocking.nc) {
+        int nc = std::min(blocking.nc, N - jc);
+        for (int pc = 0; pc < K; pc += kc_block) {
+            int kc = std::min(kc_block, K - pc);
+            int kc_padded = (kc + G - 1) / G * G;
+            bool beta = pc > 0 || accumulate;
+            packB(pc, jc, kc, nc, kc_padded, packedB.get());
+            for (int ic = 0; ic < M; ic += blocking.mc) {
+                int mc = std::min(blocking.mc, M - ic);
+                packA(ic, pc, mc, kc, kc_padded, packedA.get());
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    int cols = std::min(GEMM_NR, nc - jr);
+                    const BElem* b = packedB.get() + static_cast<size_t>(jr) * kc_padded;
+                    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                        int rows = std::min(GEMM_MR, mc - ir);
+                        const APacked* a = packedA.get() + static_cast<size_t>(ir) * kc_padded;
+                        CElem* c = C + static_cast<size_t>(ic + ir) * ldc + jc + jr;
+                        if (rows == GEMM_MR && cols == GEMM_NR) {
+                            kernel(kc_padded, a, b, jr, c, ldc, beta);
+                        } else {
+                            kernel(kc_padded, a, b, jr, tile, GEMM_NR, false);
+                            for (int i = 0; i < rows; ++i) {
+                                CElem* row = c + static_cast<size_t>(i) * ldc;
+                                for (int j = 0; j < cols; ++j) {
+                                    row[j] = (beta ? row[j] : CElem(0)) + tile[i * GEMM_NR + j];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+// C (M x N, fp32) = A (M x K, bf16) * B (K x N, bf16), or C += A * B.
+// Row-major with leading dimensions in elements, as gemm().
+inline void gemmBf16(int M, int N, int K,
+                     const uint16_t* A, int lda,
+                     const uint16_t* B, int ldb,
+                     float* C, int ldc,
+                     bool accumulate = false,
+                     const GemmBlocking& blocking = GemmBlocking()) {
+    detail::gemmLowpDriver<GEMM_BF16_GROUP, uint16_t, uint16_t>(
+        M, N, K, C, ldc, accumulate, blocking,
+        [&](int ic, int pc, int mc, int kc, int kc_padded, uint16_t* packed) {
+            detail::packALowp<GEMM_BF16_GROUP>(mc, kc, kc_padded, A + static_cast<size_t>(ic) * lda + pc, lda,
+                                 packed, [](uint16_t v) { return v; });
+        },
+        [&](int pc, int jc, int kc, int nc, int kc_padded, uint16_t* packed) {
+            detail::packBLowp<GEMM_BF16_GROUP>(kc, nc, kc_padded, B + static_cast<size_t>(pc) * ldb + jc, ldb, packed);
+        },
+        [](int kc_padded, const uint16_t* a, const uint16_t* b, int, float* c, int ldc, bool beta) {
+            detail::microKernelBf16(kc_padded, a, b, c, ldc, beta ? 1.0f : 0.0f);
+        });
+}
+
+// C (M x N, int32) = A (M x K, int8) * B (K x N, int8), or C += A * B.
+// Exact as long as K * 127 * 255 fits in int32 (K < ~66000).
+inline void gemmInt8(int M, int N, int K,
+                     const int8_t* A, int lda,
+                     const int8_t* B, int ldb,
+                     int32_t* C, int ldc,
+                     bool accumulate = false,
+                     const GemmBlocking& blocking = GemmBlocking()) {
+    const int nc_max = std::min(roundGemmBlocking(blocking).nc, (N + GEMM_NR - 1) / GEMM_NR * GEMM_NR);
+    auto comp = detail::allocateLowpBuffer<int32_t>(static_cast<size_t>(std::max(nc_max, GEMM_NR)));
+    detail::gemmLowpDriver<GEMM_INT8_GROUP, uint8_t, int8_t>(
+        M, N, K, C, ldc, accumulate, blocking,
+        [&](int ic, int pc, int mc, int kc, int kc_padded, uint8_t* packed) {
+            detail::packALowp<GEMM_INT8_GROUP>(mc, kc, kc_padded, A + static_cast<size_t>(ic) * lda + pc, lda,
+                                 packed, [](int8_t v) { return static_cast<uint8_t>(v + 128); });
+        },
+        [&](int pc, int jc, int kc, int nc, int kc_padded, int8_t* packed) {
+            const int8_t* block = B + static_cast<size_t>(pc) * ldb + jc;
+            detail::packBLowp<GEMM_INT8_GROUP>(kc, nc, kc_padded, block, ldb, packed);
+            detail::int8Compensation(kc, nc, block, ldb, comp.get());
+        },
+        [&](int kc_padded, const uint8_t* a, const int8_t* b, int jr, int32_t* c, int ldc, bool beta) {
+            detail::microKernelInt8(kc_padded, a, b, comp.get() + jr, c, ldc, beta ? 1 : 0);
+        });
+}
+
+} // namespace hpc
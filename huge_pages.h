@@ -0,0 +1,274 @@
+#pragma once
+
+// Huge-page backed arrays with parallel first-touch initialization.
+//
+// Large buffers from new / std::vector get 4 KB pages: a 256 MB array needs
+// 65536 TLB entries, far beyond the ~1.5-2K of a second-level TLB, so
+// random and strided access pays a page walk on most loads. With 2 MB pages
+// the same array needs 128 entries. HugePageArray<T> maps its storage with
+//
+//   PagePolicy::Huge     - MAP_HUGETLB (reserved hugetlbfs pages, see
+//                          /proc/sys/vm/nr_hugepages); if none are
+//                          available, an ordinary mapping aligned to 2 MB
+//                          with madvise(MADV_HUGEPAGE) so transparent huge
+//                          pages back it as it is touched
+//   PagePolicy::Regular  - 4 KB pages, MADV_NOHUGEPAGE; the baseline
+//
+// Memory is not touched by the constructor. Linux places a page on the NUMA
+// node of the thread that first writes it, so parallelFill() /
+// parallelGenerate() initialize with an OpenMP static schedule: a consumer
+// using schedule(static) over the same index range then finds its part of
+// the array on its own node. Off Linux the array falls back to
+// aligned_alloc and the policy is ignored.
+//
+// An array can also take its storage from a std::pmr::memory_resource,
+// typically an ArenaResource (arena.h) whose chunks are huge-page mappings;
+// the memory is then accounted by, and returned to, that resource.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace hpc {
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+enum class PagePolicy { Huge, Regular };
+
+// How an array's storage was actually obtained
+enum class PageBacking { HugeTLB, TransparentHuge, Regular, Heap, Resource };
+
+inline const char* pageBackingName(PageBacking backing) {
+    switch (backing) {
+        case PageBacking::HugeTLB: return "hugetlbfs 2 MB pages";
+        case PageBacking::TransparentHuge: return "transparent huge pages";
+        case PageBacking::Regular: return "4 KB pages";
+        case PageBacking::Heap: return "heap";
+        case PageBacking::Resource: return "memory resource";
+    }
+    return "unknown";
+}
+
+template <typename T>
+class HugePageArray {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "HugePageArray holds raw, uninitialized storage");
+
+public:
+    // alignment must be a power of two; the default lets the first and last
+    // 2 MB of the array be huge pages too
+    explicit HugePageArray(size_t count, PagePolicy policy = PagePolicy::Huge,
+                           size_t alignment = HUGE_PAGE_SIZE)
+        : size_(count) {
+        allocate(std::max<size_t>(count, 1) * sizeof(T), policy, std::max(alignment, alignof(T)));
+    }
+
+    // Uninitialized storage from resource, which must outlive the array
+    HugePageArray(size_t count, std::pmr::memory_resource* resource, size_t alignment = 64)
+        : size_(count), resource_(resource), alignment_(std::max(alignment, alignof(T))) {
+        mapped_bytes_ = std::max<size_t>(count, 1) * sizeof(T);
+        data_ = static_cast<T*>(resource_->allocate(mapped_bytes_, alignment_));
+        backing_ = PageBacking::Resource;
+    }
+
+    HugePageArray(HugePageArray&& other) noexcept { swap(other); }
+    HugePageArray& operator=(HugePageArray&& other) noexcept {
+        HugePageArray(std::move(other)).swap(*this);
+        return *this;
+    }
+    HugePageArray(const HugePageArray&) = delete;
+    HugePageArray& operator=(const HugePageArray&) = delete;
+
+    ~HugePageArray() { release(); }
+
+    size_t size() const { return size_; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    PageBacking backing() const { return backing_; }
+
+    // Bytes currently backed by huge pages. Transparent huge pages are only
+    // assigned on first touch (and may be refused), so this is read back from
+    // /proc/self/smaps rather than assumed.
+    size_t hugePageBytes() const {
+        if (backing_ == PageBacking::HugeTLB) {
+            return mapped_bytes_;
+        }
+#if defined(__linux__)
+        if (backing_ != PageBacking::Heap) {
+            return std::min(mapped_bytes_, smapsAnonHugeBytes(reinterpret_cast<uintptr_t>(data_)));
+        }
+#endif
+        return 0;
+    }
+
+    // data[i] = value, first touch split over threads with a static schedule
+    void parallelFill(const T& value) {
+        parallelGenerate([&value](size_t) { return value; });
+    }
+
+    // data[i] = generator(i); generator must be safe to call concurrently
+    template <typename Generator>
+    void parallelGenerate(Generator&& generator) {
+        const long long n = static_cast<long long>(size_);
+        T* out = data_;
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < n; ++i) {
+            out[i] = generator(static_cast<size_t>(i));
+        }
+    }
+
+private:
+    void allocate(size_t bytes, PagePolicy policy, size_t alignment) {
+#if defined(__linux__)
+        if (policy == PagePolicy::Huge && alignment <= HUGE_PAGE_SIZE) {
+            const size_t length = roundUp(bytes, HUGE_PAGE_SIZE);
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                map_base_ = p;
+                map_length_ = length;
+                mapped_bytes_ = length;
+                data_ = static_cast<T*>(p);
+                backing_ = PageBacking::HugeTLB;
+                return;
+            }
+        }
+
+        // Over-map by the alignment and trim both ends, so the kept range
+        // starts on an alignment boundary
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        alignment = std::max(alignment, page);
+        const size_t length = roundUp(bytes, page);
+        void* raw = mmap(nullptr, length + alignment, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        const uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        const uintptr_t aligned = roundUp(base, alignment);
+        if (aligned > base) {
+            munmap(raw, aligned - base);
+        }
+        const size_t tail = (base + length + alignment) - (aligned + length);
+        if (tail > 0) {
+            munmap(reinterpret_cast<void*>(aligned + length), tail);
+        }
+        map_base_ = reinterpret_cast<void*>(aligned);
+        map_length_ = length;
+        mapped_bytes_ = length;
+        data_ = reinterpret_cast<T*>(aligned);
+        if (policy == PagePolicy::Huge) {
+            madvise(map_base_, map_length_, MADV_HUGEPAGE);
+            backing_ = PageBacking::TransparentHuge;
+        } else {
+            madvise(map_base_, map_length_, MADV_NOHUGEPAGE);
+            backing_ = PageBacking::Regular;
+        }
+#else
+        (void)policy;
+        const size_t length = roundUp(bytes, alignment);
+        void* p = std::aligned_alloc(alignment, length);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        data_ = static_cast<T*>(p);
+        mapped_bytes_ = length;
+        backing_ = PageBacking::Heap;
+#endif
+    }
+
+    void release() {
+        if (!data_) {
+            return;
+        }
+        if (resource_) {
+            resource_->deallocate(data_, mapped_bytes_, alignment_);
+            data_ = nullptr;
+            return;
+        }
+#if defined(__linux__)
+        munmap(map_base_, map_length_);
+#else
+        std::free(data_);
+#endif
+        data_ = nullptr;
+    }
+
+    void swap(HugePageArray& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(map_base_, other.map_base_);
+        std::swap(map_length_, other.map_length_);
+        std::swap(mapped_bytes_, other.mapped_bytes_);
+        std::swap(backing_, other.backing_);
+        std::swap(resource_, other.resource_);
+        std::swap(alignment_, other.alignment_);
+    }
+
+    template <typename U>
+    static U roundUp(U value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+#if defined(__linux__)
+    // AnonHugePages of the mapping containing address, in bytes
+    static size_t smapsAnonHugeBytes(uintptr_t address) {
+        FILE* smaps = std::fopen("/proc/self/smaps", "r");
+        if (!smaps) {
+            return 0;
+        }
+        char line[256];
+        bool in_mapping = false;
+        size_t bytes = 0;
+        while (std::fgets(line, sizeof(line), smaps)) {
+            unsigned long long begin = 0, end = 0;
+            if (std::sscanf(line, "%llx-%llx ", &begin, &end) == 2) {
+                if (in_mapping) {
+                    break;
+                }
+                in_mapping = address >= begin && address < end;
+                continue;
+            }
+            unsigned long long kb = 0;
+            if (in_mapping && std::sscanf(line, "AnonHugePages: %llu kB", &kb) == 1) {
+                bytes = static_cast<size_t>(kb) * 1024;
+            }
+        }
+        std::fclose(smaps);
+        return bytes;
+    }
+#endif
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    void* map_base_ = nullptr;
+    size_t map_length_ = 0;
+    size_t mapped_bytes_ = 0;
+    PageBacking backing_ = PageBacking::Heap;
+    std::pmr::memory_resource* resource_ = nullptr;
+    size_t alignment_ = 0;
+};
+
+} // namespace hpc
@@ -0,0 +1,504 @@
+#pragma once
+
+// Expression-template vectors: arithmetic on vectors builds a lazy tree that
+// is evaluated in one fused pass when it is assigned or reduced, instead of
+// one pass (and one temporary array) per operator.
+//
+//   hpc::LazyVector<float> a(n);
+//   auto B = hpc::lazy(b), C = hpc::lazy(c);   // views of std::vector<float>
+//   a = sqrt(B * B + C * C);                   // one read of b and c, one write of a
+//   float s = hpc::sum(sqrt(B * B + C * C));   // no write at all
+//   float d = hpc::dot(B, C);
+//
+// Evaluation runs over blocks of LAZY_BLOCK elements:
+//   - subtrees made only of + - * /, unary -, abs, min, max, scalars and
+//     vectors are element-wise: each block is one loop that the compiler
+//     vectorizes (#pragma omp simd), with every intermediate in registers.
+//   - sqrt, rsqrt, exp, log and hypot (float only) call the dispatched
+//     kernels of simd_math.h, which work on arrays: their operand is
+//     evaluated into a block buffer on the stack, which stays in L1, so
+//     memory is still streamed exactly once. (std::sqrt and friends would
+//     not vectorize in the element-wise loop without -fno-math-errno.)
+//   - n >= LAZY_PARALLEL_MIN spreads the blocks over the OpenMP threads
+//     (LazyExec::Auto); LazyExec::Serial / Parallel force either choice.
+//
+// Reductions (sum, dot) accumulate each block in the element type and the
+// blocks in double, so the thread count changes the result by far less
+// than the final rounding to the element type.
+//
+// Every node reads its operands at the index it writes, and writes a block
+// only once all of its operands' values for that block are read, so
+// assigning an expression to one of its own operands (x = x * 2 + y,
+// x = sqrt(y) + x) is safe. Operands must have the same size
+// (std::invalid_argument otherwise), and views (hpc::lazy) must outlive the
+// expressions built from them.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "simd_math.h"
+
+namespace hpc {
+
+// Elements per evaluation block of a tree containing math functions
+constexpr size_t LAZY_BLOCK = 256;
+// Expressions at least this long are evaluated by all OpenMP threads
+constexpr size_t LAZY_PARALLEL_MIN = size_t(1) << 16;
+
+enum class LazyExec { Auto, Serial, Parallel };
+
+// CRTP base of every expression node. A node provides:
+//   value_type, size(), elementwise (operator[](i) is available),
+//   scratchBlocks (LAZY_BLOCK buffers evalBlock needs besides out) and
+//   evalBlock(begin, len, out, scratch), which returns a pointer to the
+//   len results: out, or the node's own storage for a vector.
+template <typename E>
+struct VecExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename T>
+class LazyVector;
+
+// Non-owning view of contiguous storage
+template <typename T>
+class VecView : public VecExpr<VecView<T>> {
+public:
+    using value_type = T;
+    static constexpr bool elementwise = true;
+    static constexpr bool scalar = false;
+    static constexpr size_t scratchBlocks = 0;
+
+    VecView(const T* data, size_t n) : data_(data), n_(n) {}
+
+    size_t size() const { return n_; }
+    T operator[](size_t i) const { return data_[i]; }
+    const T* evalBlock(size_t begin, size_t, T*, T*) const { return data_ + begin; }
+
+private:
+    const T* data_;
+    size_t n_;
+};
+
+template <typename T>
+VecView<T> lazy(const std::vector<T>& v) { return VecView<T>(v.data(), v.size()); }
+
+template <typename T>
+VecView<T> lazy(const T* data, size_t n) { return VecView<T>(data, n); }
+
+namespace detail {
+
+// A scalar operand, broadcast to the length of the other operand
+template <typename T>
+class LazyScalar : public VecExpr<LazyScalar<T>> {
+public:
+    using value_type = T;
+    static constexpr bool elementwise = true;
+    static constexpr bool scalar = true;
+    static constexpr size_t scratchBlocks = 0;
+
+    explicit LazyScalar(T value) : value_(value) {}
+
+    size_t size() const { return 0; }
+    T operator[](size_t) const { return value_; }
+    const T* evalBlock(size_t, size_t len, T* out, T*) const {
+        std::fill(out, out + len, value_);
+        return out;
+    }
+
+private:
+    T value_;
+};
+
+// Expressions hold their operands by value; a LazyVector operand is held as
+// a view of its storage so building an expression never copies data
+template <typename E>
+struct LazyOperand { using type = E; };
+
+template <typename T>
+struct LazyOperand<LazyVector<T>> { using type = VecView<T>; };
+
+template <typename E>
+using LazyOperandT = typename LazyOperand<E>::type;
+
+template <typename E>
+LazyOperandT<E> lazyOperand(const VecExpr<E>& e) { return LazyOperandT<E>(e.self()); }
+
+template <typename L, typename R>
+size_t lazyCommonSize(const L& l, const R& r) {
+    if constexpr (L::scalar) {
+        return r.size();
+    } else if constexpr (R::scalar) {
+        return l.size();
+    } else {
+        if (l.size() != r.size()) {
+            throw std::invalid_argument("lazy vector operands differ in size: " + std::to_string(l.size()) +
+                                        " vs " + std::to_string(r.size()));
+        }
+        return l.size();
+    }
+}
+
+struct LazyAdd { template <typename T> static T apply(T a, T b) { return a + b; } };
+struct LazySub { template <typename T> static T apply(T a, T b) { return a - b; } };
+struct LazyMul { template <typename T> static T apply(T a, T b) { return a * b; } };
+struct LazyDiv { template <typename T> static T apply(T a, T b) { return a / b; } };
+struct LazyMin { template <typename T> static T apply(T a, T b) { return b < a ? b : a; } };
+struct LazyMax { template <typename T> static T apply(T a, T b) { return a < b ? b : a; } };
+struct LazyNeg { template <typename T> static T apply(T a) { return -a; } };
+struct LazyAbs { template <typename T> static T apply(T a) { return std::abs(a); } };
+
+// Element-wise loops over one block. They run on a local copy of the
+// expression so its pointers and scalars stay in registers; read through
+// the original they would be reloaded after every store to out, which keeps
+// the loop from vectorizing.
+template <typename T, typename E>
+void lazyStoreBlock(T* out, const E& expr, size_t begin, size_t len) {
+    const E e = expr;
+    #pragma omp simd
+    for (size_t j = 0; j < len; ++j) {
+        out[j] = e[begin + j];
+    }
+}
+
+template <typename E>
+typename E::value_type lazySumBlock(const E& expr, size_t begin, size_t len) {
+    const E e = expr;
+    typename E::value_type partial = 0;
+    #pragma omp simd reduction(+:partial)
+    for (size_t j = 0; j < len; ++j) {
+        partial += e[begin + j];
+    }
+    return partial;
+}
+
+template <typename Op, typename L, typename R>
+class LazyBinary : public VecExpr<LazyBinary<Op, L, R>> {
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same_v<value_type, typename R::value_type>, "lazy operands must have the same element type");
+    static constexpr bool elementwise = L::elementwise && R::elementwise;
+    static constexpr bool scalar = false;
+    // Element-wise nodes write straight into out; otherwise each operand is
+    // evaluated into a block of its own, since out may be the storage of a
+    // vector operand that has not been read yet (x = sqrt(y) + x)
+    static constexpr size_t scratchBlocks =
+        elementwise ? 0 : 2 + L::scratchBlocks + R::scratchBlocks;
+
+    LazyBinary(const L& l, const R& r) : l_(l), r_(r), n_(lazyCommonSize(l, r)) {}
+
+    size_t size() const { return n_; }
+
+    value_type operator[](size_t i) const { return Op::apply(l_[i], r_[i]); }
+
+    const value_type* evalBlock(size_t begin, size_t len, value_type* out, value_type* scratch) const {
+        if constexpr (elementwise) {
+            lazyStoreBlock(out, *this, begin, len);
+        } else {
+            value_type* rout = scratch + (1 + L::scratchBlocks) * LAZY_BLOCK;
+            const value_type* a = l_.evalBlock(begin, len, scratch, scratch + LAZY_BLOCK);
+            const value_type* b = r_.evalBlock(begin, len, rout, rout + LAZY_BLOCK);
+            #pragma omp simd
+            for (size_t j = 0; j < len; ++j) {
+                out[j] = Op::apply(a[j], b[j]);
+            }
+        }
+        return out;
+    }
+
+private:
+    L l_;
+    R r_;
+    size_t n_;
+};
+
+template <typename Op, typename E>
+class LazyUnary : public VecExpr<LazyUnary<Op, E>> {
+public:
+    using value_type = typename E::value_type;
+    static constexpr bool elementwise = E::elementwise;
+    static constexpr bool scalar = false;
+    static constexpr size_t scratchBlocks = E::scratchBlocks;
+
+    explicit LazyUnary(const E& e) : e_(e) {}
+
+    size_t size() const { return e_.size(); }
+
+    value_type operator[](size_t i) const { return Op::apply(e_[i]); }
+
+    const value_type* evalBlock(size_t begin, size_t len, value_type* out, value_type* scratch) const {
+        if constexpr (elementwise) {
+            lazyStoreBlock(out, *this, begin, len);
+        } else {
+            const value_type* a = e_.evalBlock(begin, len, out, scratch);
+            #pragma omp simd
+            for (size_t j = 0; j < len; ++j) {
+                out[j] = Op::apply(a[j]);
+            }
+        }
+        return out;
+    }
+
+private:
+    E e_;
+};
+
+// sqrt / rsqrt / exp / log through a simd_math.h array kernel. The operand
+// is evaluated into out and the kernel runs in place.
+template <typename E>
+class LazyMath : public VecExpr<LazyMath<E>> {
+public:
+    using value_type = float;
+    static_assert(std::is_same_v<typename E::value_type, float>, "lazy math functions need float operands");
+    static constexpr bool elementwise = false;
+    static constexpr bool scalar = false;
+    static constexpr size_t scratchBlocks = E::scratchBlocks;
+
+    using Kernel = void (*)(const float*, float*, size_t);
+
+    LazyMath(const E& e, Kernel kernel) : e_(e), kernel_(kernel) {}
+
+    size_t size() const { return e_.size(); }
+
+    const float* evalBlock(size_t begin, size_t len, float* out, float* scratch) const {
+        kernel_(e_.evalBlock(begin, len, out, scratch), out, len);
+        return out;
+    }
+
+private:
+    E e_;
+    Kernel kernel_;
+};
+
+template <typename L, typename R>
+class LazyHypot : public VecExpr<LazyHypot<L, R>> {
+public:
+    using value_type = float;
+    static_assert(std::is_same_v<typename L::value_type, float> && std::is_same_v<typename R::value_type, float>,
+                  "lazy math functions need float operands");
+    static constexpr bool elementwise = false;
+    static constexpr bool scalar = false;
+    // Both operands get blocks of their own, as in LazyBinary
+    static constexpr size_t scratchBlocks = 2 + L::scratchBlocks + R::scratchBlocks;
+
+    using Kernel = void (*)(const float*, const float*, float*, size_t);
+
+    LazyHypot(const L& l, const R& r, Kernel kernel) : l_(l), r_(r), n_(lazyCommonSize(l, r)), kernel_(kernel) {}
+
+    size_t size() const { return n_; }
+
+    const float* evalBlock(size_t begin, size_t len, float* out, float* scratch) const {
+        float* rout = scratch + (1 + L::scratchBlocks) * LAZY_BLOCK;
+        const float* x = l_.evalBlock(begin, len, scratch, scratch + LAZY_BLOCK);
+        const float* y = r_.evalBlock(begin, len, rout, rout + LAZY_BLOCK);
+        kernel_(x, y, out, len);
+        return out;
+    }
+
+private:
+    L l_;
+    R r_;
+    size_t n_;
+    Kernel kernel_;
+};
+
+inline bool lazyParallel(LazyExec exec, size_t n) {
+    return exec == LazyExec::Parallel || (exec == LazyExec::Auto && n >= LAZY_PARALLEL_MIN);
+}
+
+template <typename T, typename E>
+void lazyEvaluate(T* dst, const E& e, LazyExec exec) {
+    const size_t n = e.size();
+    const size_t blocks = (n + LAZY_BLOCK - 1) / LAZY_BLOCK;
+    #pragma omp parallel for schedule(static) if(lazyParallel(exec, n))
+    for (size_t k = 0; k < blocks; ++k) {
+        alignas(64) T scratch[(E::scratchBlocks > 0 ? E::scratchBlocks : 1) * LAZY_BLOCK];
+        const size_t begin = k * LAZY_BLOCK;
+        const size_t len = std::min(LAZY_BLOCK, n - begin);
+        const T* values = e.evalBlock(begin, len, dst + begin, scratch);
+        if (values != dst + begin) {
+            // A plain vector (assign(a, lazy(b))) returns its own storage
+            std::copy(values, values + len, dst + begin);
+        }
+    }
+}
+
+template <typename E>
+double lazySum(const E& e, LazyExec exec) {
+    using T = typename E::value_type;
+    const size_t n = e.size();
+    const size_t blocks = (n + LAZY_BLOCK - 1) / LAZY_BLOCK;
+    double total = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:total) if(lazyParallel(exec, n))
+    for (size_t k = 0; k < blocks; ++k) {
+        const size_t begin = k * LAZY_BLOCK;
+        const size_t len = std::min(LAZY_BLOCK, n - begin);
+        if constexpr (E::elementwise) {
+            total += static_cast<double>(lazySumBlock(e, begin, len));
+        } else {
+            alignas(64) T out[LAZY_BLOCK];
+            alignas(64) T scratch[(E::scratchBlocks > 0 ? E::scratchBlocks : 1) * LAZY_BLOCK];
+            const T* values = e.evalBlock(begin, len, out, scratch);
+            total += static_cast<double>(lazySumBlock(VecView<T>(values, len), 0, len));
+        }
+    }
+    return total;
+}
+
+// The scalar operand of a vector-scalar operator, converted to the
+// vector's element type
+template <typename E, typename S>
+using LazyScalarFor = std::enable_if_t<std::is_arithmetic_v<S>, LazyScalar<typename E::value_type>>;
+
+} // namespace detail
+
+// Owning vector; assigning an expression evaluates it in one pass
+template <typename T>
+class LazyVector : public VecExpr<LazyVector<T>> {
+public:
+    using value_type = T;
+    static constexpr bool elementwise = true;
+    static constexpr bool scalar = false;
+    static constexpr size_t scratchBlocks = 0;
+
+    LazyVector() = default;
+    explicit LazyVector(size_t n, T value = T()) : data_(n, value) {}
+    explicit LazyVector(std::vector<T> data) : data_(std::move(data)) {}
+
+    template <typename E>
+    LazyVector(const VecExpr<E>& e) : data_(e.self().size()) {
+        detail::lazyEvaluate(data_.data(), e.self(), LazyExec::Auto);
+    }
+
+    template <typename E>
+    LazyVector& operator=(const VecExpr<E>& e) {
+        assign(e, LazyExec::Auto);
+        return *this;
+    }
+
+    // Evaluates e into this vector, resizing it if it is empty
+    template <typename E>
+    void assign(const VecExpr<E>& e, LazyExec exec) {
+        if (data_.empty()) {
+            data_.resize(e.self().size());
+        } else if (data_.size() != e.self().size()) {
+            throw std::invalid_argument("lazy vector assignment size mismatch: " + std::to_string(data_.size()) +
+                                        " vs " + std::to_string(e.self().size()));
+        }
+        detail::lazyEvaluate(data_.data(), e.self(), exec);
+    }
+
+    size_t size() const { return data_.size(); }
+    T* data() { return data_.data(); }
+    const T* data() const { return data_.data(); }
+    T& operator[](size_t i) { return data_[i]; }
+    T operator[](size_t i) const { return data_[i]; }
+    const T* evalBlock(size_t begin, size_t, T*, T*) const { return data_.data() + begin; }
+
+    operator VecView<T>() const { return VecView<T>(data_.data(), data_.size()); }
+    const std::vector<T>& vector() const { return data_; }
+
+private:
+    std::vector<T> data_;
+};
+
+// Evaluates e into an existing std::vector of the same size
+template <typename T, typename E>
+void assign(std::vector<T>& dst, const VecExpr<E>& e, LazyExec exec = LazyExec::Auto) {
+    if (dst.size() != e.self().size()) {
+        throw std::invalid_argument("lazy vector assignment size mismatch: " + std::to_string(dst.size()) +
+                                    " vs " + std::to_string(e.self().size()));
+    }
+    detail::lazyEvaluate(dst.data(), e.self(), exec);
+}
+
+// Element-wise operators: vector op vector, vector op scalar, scalar op vector
+#define HPC_LAZY_BINARY_OP(op, Functor)                                                                \
+    template <typename L, typename R>                                                                  \
+    detail::LazyBinary<detail::Functor, detail::LazyOperandT<L>, detail::LazyOperandT<R>> operator op( \
+        const VecExpr<L>& l, const VecExpr<R>& r) {                                                    \
+        return {detail::lazyOperand(l), detail::lazyOperand(r)};                                       \
+    }                                                                                                  \
+    template <typename E, typename S>                                                                  \
+    detail::LazyBinary<detail::Functor, detail::LazyOperandT<E>, detail::LazyScalarFor<E, S>>          \
+    operator op(const VecExpr<E>& e, S s) {                                                            \
+        return {detail::lazyOperand(e), detail::LazyScalarFor<E, S>(s)};                               \
+    }                                                                                                  \
+    template <typename S, typename E>                                                                  \
+    detail::LazyBinary<detail::Functor, detail::LazyScalarFor<E, S>, detail::LazyOperandT<E>>          \
+    operator op(S s, const VecExpr<E>& e) {                                                            \
+        return {detail::LazyScalarFor<E, S>(s), detail::lazyOperand(e)};                               \
+    }
+
+HPC_LAZY_BINARY_OP(+, LazyAdd)
+HPC_LAZY_BINARY_OP(-, LazySub)
+HPC_LAZY_BINARY_OP(*, LazyMul)
+HPC_LAZY_BINARY_OP(/, LazyDiv)
+
+#undef HPC_LAZY_BINARY_OP
+
+template <typename L, typename R>
+detail::LazyBinary<detail::LazyMin, detail::LazyOperandT<L>, detail::LazyOperandT<R>> min(const VecExpr<L>& l,
+                                                                                           const VecExpr<R>& r) {
+    return {detail::lazyOperand(l), detail::lazyOperand(r)};
+}
+
+template <typename L, typename R>
+detail::LazyBinary<detail::LazyMax, detail::LazyOperandT<L>, detail::LazyOperandT<R>> max(const VecExpr<L>& l,
+                                                                                           const VecExpr<R>& r) {
+    return {detail::lazyOperand(l), detail::lazyOperand(r)};
+}
+
+template <typename E>
+detail::LazyUnary<detail::LazyNeg, detail::LazyOperandT<E>> operator-(const VecExpr<E>& e) {
+    return detail::LazyUnary<detail::LazyNeg, detail::LazyOperandT<E>>(detail::lazyOperand(e));
+}
+
+template <typename E>
+detail::LazyUnary<detail::LazyAbs, detail::LazyOperandT<E>> abs(const VecExpr<E>& e) {
+    return detail::LazyUnary<detail::LazyAbs, detail::LazyOperandT<E>>(detail::lazyOperand(e));
+}
+
+// Math functions, evaluated with the simd_math.h kernels of the dispatched ISA
+template <typename E>
+detail::LazyMath<detail::LazyOperandT<E>> sqrt(const VecExpr<E>& e, MathAccuracy accuracy = MathAccuracy::Accurate) {
+    return {detail::lazyOperand(e), simdMath(accuracy).sqrt};
+}
+
+template <typename E>
+detail::LazyMath<detail::LazyOperandT<E>> rsqrt(const VecExpr<E>& e, MathAccuracy accuracy = MathAccuracy::Accurate) {
+    return {detail::lazyOperand(e), simdMath(accuracy).rsqrt};
+}
+
+template <typename E>
+detail::LazyMath<detail::LazyOperandT<E>> exp(const VecExpr<E>& e, MathAccuracy accuracy = MathAccuracy::Accurate) {
+    return {detail::lazyOperand(e), simdMath(accuracy).exp};
+}
+
+template <typename E>
+detail::LazyMath<detail::LazyOperandT<E>> log(const VecExpr<E>& e, MathAccuracy accuracy = MathAccuracy::Accurate) {
+    return {detail::lazyOperand(e), simdMath(accuracy).log};
+}
+
+template <typename L, typename R>
+detail::LazyHypot<detail::LazyOperandT<L>, detail::LazyOperandT<R>> hypot(
+    const VecExpr<L>& l, const VecExpr<R>& r, MathAccuracy accuracy = MathAccuracy::Accurate) {
+    return {detail::lazyOperand(l), detail::lazyOperand(r), simdMath(accuracy).hypot};
+}
+
+// Reductions, fused with the expression they reduce
+template <typename E>
+typename E::value_type sum(const VecExpr<E>& e, LazyExec exec = LazyExec::Auto) {
+    return static_cast<typename E::value_type>(detail::lazySum(detail::lazyOperand(e), exec));
+}
+
+template <typename L, typename R>
+typename L::value_type dot(const VecExpr<L>& l, const VecExpr<R>& r, LazyExec exec = LazyExec::Auto) {
+    return sum(l * r, exec);
+}
+
+} // namespace hpc
@@ -0,0 +1,340 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <unistd.h>
+#include "cache_topology.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Memory hierarchy characterization:
+//   1. Latency curve   - dependent pointer chase over working sets from 4 KB up
+//   2. STREAM          - copy / scale / add / triad bandwidth for 1..N threads
+//   3. TLB sensitivity - one line per page vs the same lines packed densely
+//
+// Usage: memory_hierarchy [--csv] [--max-mb N] [--stream-mb N] [latency] [stream] [tlb]
+// With no part names all three run. Knees in the latency curve show the
+// effective L1/L2/L3/DRAM boundaries; the STREAM table shows how many threads
+// it takes to saturate DRAM.
+
+struct Options {
+    bool csv = false;
+    size_t max_bytes = 2048ull * 1024 * 1024;  // largest latency working set
+    size_t stream_bytes = 0;                   // per STREAM array; 0 = 4x LLC, capped
+    bool latency = false;
+    bool stream = false;
+    bool tlb = false;
+};
+
+class MemoryHierarchyProbe {
+private:
+    static constexpr size_t CHASE_LOADS = 4 * 1024 * 1024;
+    static constexpr int STREAM_REPEATS = 5;
+
+    Options options_;
+    const hpc::CacheTopology& topology_;
+
+public:
+    explicit MemoryHierarchyProbe(const Options& options)
+        : options_(options), topology_(hpc::cacheTopology()) {}
+
+    void latencySweep() {
+        printSection("Load-to-use latency (dependent pointer chase)");
+        if (options_.csv) {
+            std::cout << "working_set_bytes,ns_per_load,level\n";
+        } else {
+            std::cout << std::setw(14) << "Working set" << std::setw(14) << "ns/load"
+                      << std::setw(10) << "Fits in" << "\n";
+        }
+
+        // Powers of two plus the 1.5x midpoints, so knees are not missed
+        std::vector<size_t> sizes;
+        for (size_t size = 4 * 1024; size <= options_.max_bytes; size *= 2) {
+            sizes.push_back(size);
+            if (size + size / 2 <= options_.max_bytes) {
+                sizes.push_back(size + size / 2);
+            }
+        }
+
+        for (size_t bytes : sizes) {
+            size_t nodes = bytes / topology_.line_size;
+            std::vector<size_t> order = randomCycle(nodes);
+            double ns = chaseLines(order, topology_.line_size);
+            if (options_.csv) {
+                std::cout << bytes << "," << std::fixed << std::setprecision(3) << ns << ","
+                          << levelFor(bytes) << "\n";
+            } else {
+                std::cout << std::setw(14) << formatBytes(bytes)
+                          << std::setw(14) << std::fixed << std::setprecision(2) << ns
+                          << std::setw(10) << levelFor(bytes) << "\n";
+            }
+        }
+    }
+
+    void streamBandwidth() {
+        printSection("STREAM bandwidth (best of " + std::to_string(STREAM_REPEATS) + ")");
+
+        size_t llc = topology_.dataCacheSize(3, 8 * 1024 * 1024);
+        size_t bytes = options_.stream_bytes;
+        if (bytes == 0) {
+            bytes = std::min<size_t>(4 * llc, 512ull * 1024 * 1024);
+        }
+        const size_t n = bytes / sizeof(double);
+        if (!options_.csv) {
+            std::cout << "Array size: " << formatBytes(n * sizeof(double)) << " x 3";
+            if (bytes < 4 * llc) {
+                std::cout << " (below 4x LLC = " << formatBytes(4 * llc)
+                          << "; results may include cache hits, raise --stream-mb)";
+            }
+            std::cout << "\n";
+        }
+
+        // Left uninitialized (std::vector would zero it on this thread), so
+        // the first touch below is the full team's and pages spread across
+        // memory nodes
+        std::unique_ptr<double[]> a(new double[n]), b(new double[n]), c(new double[n]);
+        const double scalar = 3.0;
+
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = 1.0;
+            b[i] = 2.0;
+            c[i] = 0.0;
+        }
+
+        if (options_.csv) {
+            std::cout << "threads,copy_gbs,scale_gbs,add_gbs,triad_gbs\n";
+        } else {
+            std::cout << std::setw(8) << "Threads" << std::setw(12) << "Copy GB/s" << std::setw(12)
+                      << "Scale GB/s" << std::setw(12) << "Add GB/s" << std::setw(12) << "Triad GB/s" << "\n";
+        }
+
+        for (int threads : threadCounts()) {
+            double* pa = a.get();
+            double* pb = b.get();
+            double* pc = c.get();
+            double copy = bestOf([&] {
+                #pragma omp parallel for schedule(static) num_threads(threads)
+                for (size_t i = 0; i < n; ++i) pc[i] = pa[i];
+            });
+            double scale = bestOf([&] {
+                #pragma omp parallel for schedule(static) num_threads(threads)
+                for (size_t i = 0; i < n; ++i) pb[i] = scalar * pc[i];
+            });
+            double add = bestOf([&] {
+                #pragma omp parallel for schedule(static) num_threads(threads)
+                for (size_t i = 0; i < n; ++i) pc[i] = pa[i] + pb[i];
+            });
+            double triad = bestOf([&] {
+                #pragma omp parallel for schedule(static) num_threads(threads)
+                for (size_t i = 0; i < n; ++i) pa[i] = pb[i] + scalar * pc[i];
+            });
+
+            const double two = 2.0 * n * sizeof(double) / 1e9;
+            const double three = 3.0 * n * sizeof(double) / 1e9;
+            if (options_.csv) {
+                std::cout << threads << std::fixed << std::setprecision(2)
+                          << "," << two / copy << "," << two / scale
+                          << "," << three / add << "," << three / triad << "\n";
+            } else {
+                std::cout << std::setw(8) << threads << std::fixed << std::setprecision(2)
+                          << std::setw(12) << two / copy << std::setw(12) << two / scale
+                          << std::setw(12) << three / add << std::setw(12) << three / triad << "\n";
+            }
+        }
+        // Keep the results observable
+        if (!options_.csv) {
+            std::cout << "Checksum: " << a[n / 2] + b[n / 3] + c[n / 5] << "\n";
+        }
+    }
+
+    void tlbSensitivity() {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        printSection("TLB sensitivity (" + std::to_string(page / 1024) + " KB pages)");
+        if (options_.csv) {
+            std::cout << "pages,dense_ns,one_per_page_ns,penalty\n";
+        } else {
+            std::cout << "Same number of cache lines, chased randomly: packed densely vs one per page\n";
+            std::cout << std::setw(10) << "Pages" << std::setw(14) << "Dense ns"
+                      << std::setw(16) << "Per-page ns" << std::setw(10) << "Penalty" << "\n";
+        }
+
+        for (size_t pages = 16; pages * page <= options_.max_bytes; pages *= 2) {
+            std::vector<size_t> order = randomCycle(pages);
+            double dense = chaseLines(order, topology_.line_size);
+            double sparse = chaseLines(order, page);
+            if (options_.csv) {
+                std::cout << pages << std::fixed << std::setprecision(3) << "," << dense << ","
+                          << sparse << "," << sparse / dense << "\n";
+            } else {
+                std::cout << std::setw(10) << pages << std::fixed << std::setprecision(2)
+                          << std::setw(14) << dense << std::setw(16) << sparse
+                          << std::setw(9) << sparse / dense << "x\n";
+            }
+        }
+    }
+
+    void run() {
+        if (!options_.csv) {
+            std::cout << hpc::describeCacheTopology(topology_);
+        }
+        if (options_.latency) latencySweep();
+        if (options_.stream) streamBandwidth();
+        if (options_.tlb) tlbSensitivity();
+    }
+
+private:
+    // Random single cycle over [0, n) (Sattolo's algorithm): next[i] is the
+    // node visited after i, and every node is reached before repeating
+    std::vector<size_t> randomCycle(size_t n) {
+        std::vector<size_t> perm(n);
+        std::iota(perm.begin(), perm.end(), 0);
+        std::mt19937_64 rng(42);
+        for (size_t i = n - 1; i > 0; --i) {
+            std::uniform_int_distribution<size_t> dist(0, i - 1);
+            std::swap(perm[i], perm[dist(rng)]);
+        }
+        std::vector<size_t> next(n);
+        for (size_t i = 0; i < n; ++i) {
+            next[perm[i]] = perm[(i + 1) % n];
+        }
+        return next;
+    }
+
+    // Lay the cycle out as pointers, node i at i * spacing bytes, and time
+    // CHASE_LOADS dependent loads. With spacing > one line, each node is also
+    // shifted by a varying line offset so the nodes don't all share cache sets.
+    double chaseLines(const std::vector<size_t>& next, size_t spacing) {
+        const size_t n = next.size();
+        const size_t line = topology_.line_size;
+        const size_t lines_per_slot = spacing / line;
+        std::vector<char> buffer(n * spacing + line);
+        char* base = reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(buffer.data()) + line - 1) / line * line);
+        auto node = [&](size_t i) {
+            size_t offset = lines_per_slot > 1 ? (i * 7 % lines_per_slot) * line : 0;
+            return base + i * spacing + offset;
+        };
+        for (size_t i = 0; i < n; ++i) {
+            *reinterpret_cast<char**>(node(i)) = node(next[i]);
+        }
+
+        // Warm-up pass over (up to) the whole cycle
+        char* p = node(0);
+        for (size_t i = 0; i < std::min(n, CHASE_LOADS); ++i) {
+            p = *reinterpret_cast<char**>(p);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < CHASE_LOADS; ++i) {
+            p = *reinterpret_cast<char**>(p);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        // The final pointer must be used or the chase is dead code
+        char* volatile sink = p;
+        (void)sink;
+        return std::chrono::duration<double, std::nano>(end - start).count() / CHASE_LOADS;
+    }
+
+    template <typename Kernel>
+    double bestOf(Kernel&& kernel) {
+        double best = 1e30;
+        for (int run = 0; run < STREAM_REPEATS; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            kernel();
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    std::vector<int> threadCounts() const {
+#ifdef _OPENMP
+        const int max_threads = omp_get_max_threads();
+#else
+        const int max_threads = 1;
+#endif
+        std::vector<int> counts;
+        for (int t = 1; t < max_threads; t *= 2) {
+            counts.push_back(t);
+        }
+        counts.push_back(max_threads);
+        return counts;
+    }
+
+    // Smallest data cache level that holds the working set
+    std::string levelFor(size_t bytes) const {
+        for (const auto& cache : topology_.levels) {
+            if (cache.type != "Instruction" && bytes <= cache.size_bytes) {
+                return "L" + std::to_string(cache.level);
+            }
+        }
+        return "DRAM";
+    }
+
+    static std::string formatBytes(size_t bytes) {
+        const char* units[] = {"B", "KB", "MB", "GB"};
+        double value = static_cast<double>(bytes);
+        int unit = 0;
+        while (value >= 1024.0 && unit < 3) {
+            value /= 1024.0;
+            ++unit;
+        }
+        std::ostringstream out;
+        out << std::setprecision(value < 10 ? 2 : 4) << value << " " << units[unit];
+        return out.str();
+    }
+
+    void printSection(const std::string& title) const {
+        if (options_.csv) {
+            std::cout << "# " << title << "\n";
+        } else {
+            std::cout << "\n=== " << title << " ===\n";
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            options.csv = true;
+        } else if (arg == "--max-mb" && i + 1 < argc) {
+            options.max_bytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--stream-mb" && i + 1 < argc) {
+            options.stream_bytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "latency") {
+            options.latency = true;
+        } else if (arg == "stream") {
+            options.stream = true;
+        } else if (arg == "tlb") {
+            options.tlb = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--csv] [--max-mb N] [--stream-mb N] [latency] [stream] [tlb]\n";
+            return 1;
+        }
+    }
+    if (!options.latency && !options.stream && !options.tlb) {
+        options.latency = options.stream = options.tlb = true;
+    }
+
+    if (!options.csv) {
+        std::cout << "=== Memory Hierarchy Characterization ===\n";
+    }
+    MemoryHierarchyProbe probe(options);
+    probe.run();
+    return 0;
+}
@@ -5,7 +5,24 @@
 #include <algorithm>
 #include <memory>
 #include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <string>
 #include <spdlog/spdlog.h>
+#include "gemm.h"
+#include "gemm_lowp.h"
+#include "cache_topology.h"
+#include "transpose.h"
+#include "soa.h"
+#include "gather.h"
+#include "huge_pages.h"
+#include "arena.h"
+#include "packed_record.h"
+#include "perf_counters.h"
+#include "benchmark.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -15,18 +32,51 @@ class MemoryOptimizationDemo {
 private:
     const size_t MATRIX_SIZE = 1024;
     const size_t ARRAY_SIZE = 16 * 1024 * 1024;  // 16MB of integers
-    const size_t CACHE_LINE_SIZE = 64;  // Typical cache line size in bytes
+    // Detected at startup (see cache_topology.h)
+    const size_t CACHE_LINE_SIZE = hpc::cacheTopology().line_size;
+    const size_t L1_CACHE_SIZE = hpc::cacheTopology().dataCacheSize(1, 32 * 1024);
+    const size_t L2_CACHE_SIZE = hpc::cacheTopology().dataCacheSize(2, 256 * 1024);
+    const size_t L3_CACHE_SIZE = hpc::cacheTopology().dataCacheSize(3, 8 * 1024 * 1024);
+    
+    // Particle system for the integrator demo: unit box, periodic, short-range
+    // repulsion within one cell of a GRID^3 cell list
+    struct Particle {
+        float x, y, z;
+        float vx, vy, vz;
+        float mass;
+    };
+    using ParticleSoA = hpc::SoA<Particle, &Particle::x, &Particle::y, &Particle::z,
+                                 &Particle::vx, &Particle::vy, &Particle::vz, &Particle::mass>;
+    static constexpr int PARTICLE_GRID = 64;
+    
+    // Every demo allocates from pool_ (std::pmr containers through the
+    // default resource, large arrays explicitly); runDemo() resets both
+    // between demos and records what each one needed
+    struct DemoMemory {
+        std::string name;
+        hpc::AllocationStats pool;
+        size_t reserved_bytes;
+    };
+    hpc::ArenaResource arena_;
+    hpc::PoolResource pool_{&arena_};
+    std::vector<DemoMemory> demo_memory_;
     
 public:
+    // memory_budget: bytes the demo arena may reserve, 0 for no limit
+    explicit MemoryOptimizationDemo(size_t memory_budget = 0) : arena_(memory_budget) {}
+    
+
     // 1. Cache-Friendly vs Cache-Unfriendly Matrix Multiplication
     void matrixMultiplicationComparison() {
         spdlog::info("=== Matrix Multiplication: Cache Optimization ===");
         
-        // Allocate matrices
-        auto A = std::make_unique<float[]>(MATRIX_SIZE * MATRIX_SIZE);
-        auto B = std::make_unique<float[]>(MATRIX_SIZE * MATRIX_SIZE);
-        auto C1 = std::make_unique<float[]>(MATRIX_SIZE * MATRIX_SIZE);
-        auto C2 = std::make_unique<float[]>(MATRIX_SIZE * MATRIX_SIZE);
+        // Allocate matrices from the demo arena (huge-page chunks), first-touched in parallel
+        const size_t count = MATRIX_SIZE * MATRIX_SIZE;
+        hpc::HugePageArray<float> A(count, &pool_), B(count, &pool_), C1(count, &pool_), C2(count, &pool_),
+            C3(count, &pool_);
+        for (auto* matrix : {&A, &B, &C1, &C2, &C3}) {
+            matrix->parallelFill(0.0f);
+        }
         
         // Initialize with random data
         std::mt19937 rng(42);
@@ -37,64 +87,210 @@ public:
             B[i] = dist(rng);
         }
         
+        // Median times in ms (benchmark.h)
+        const uint64_t flops = MATRIX_SIZE * MATRIX_SIZE * MATRIX_SIZE;
+        
         // Naive implementation (poor cache locality)
-        auto start = std::chrono::high_resolution_clock::now();
-        naiveMatrixMultiply(A.get(), B.get(), C1.get(), MATRIX_SIZE);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto naive_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        const double naive_ms = hpc::benchmark("Naive matrix multiply", flops, [&] {
+            naiveMatrixMultiply(A.data(), B.data(), C1.data(), MATRIX_SIZE);
+        }).median * 1e3;
         
         // Cache-optimized implementation
-        start = std::chrono::high_resolution_clock::now();
-        cacheOptimizedMatrixMultiply(A.get(), B.get(), C2.get(), MATRIX_SIZE);
-        end = std::chrono::high_resolution_clock::now();
-        auto optimized_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        const double optimized_ms = hpc::benchmark("Cache-optimized matrix multiply", flops, [&] {
+            cacheOptimizedMatrixMultiply(A.data(), B.data(), C2.data(), MATRIX_SIZE);
+        }).median * 1e3;
         
-        spdlog::info("Naive matrix multiply: {} ms", naive_time.count());
-        spdlog::info("Cache-optimized matrix multiply: {} ms", optimized_time.count());
-        spdlog::info("Speedup: {:.2f}x", static_cast<double>(naive_time.count()) / optimized_time.count());
+        // Packed-panel GEMM engine (register-tiled microkernel)
+        const double packed_ms = hpc::benchmark("Packed GEMM", flops, [&] {
+            packedMatrixMultiply(A.data(), B.data(), C3.data(), MATRIX_SIZE);
+        }).median * 1e3;
+        
+        spdlog::info("Naive matrix multiply: {:.1f} ms", naive_ms);
+        spdlog::info("Cache-optimized matrix multiply: {:.1f} ms", optimized_ms);
+        spdlog::info("Packed GEMM ({}) matrix multiply: {:.1f} ms", hpc::GEMM_KERNEL_NAME, packed_ms);
+        spdlog::info("Speedup: {:.2f}x", naive_ms / optimized_ms);
+        spdlog::info("Packed GEMM speedup: {:.2f}x", naive_ms / packed_ms);
         
         // Verify results are similar
         float max_diff = 0.0f;
+        float packed_max_diff = 0.0f;
         for (size_t i = 0; i < MATRIX_SIZE * MATRIX_SIZE; ++i) {
             max_diff = std::max(max_diff, std::abs(C1[i] - C2[i]));
+            packed_max_diff = std::max(packed_max_diff, std::abs(C1[i] - C3[i]));
         }
         spdlog::info("Max difference between results: {:.6f}", max_diff);
+        spdlog::info("Max difference (packed GEMM): {:.6f}", packed_max_diff);
+        
+        reducedPrecisionMatrixMultiply(A.data(), B.data(), C3.data(), packed_ms);
+    }
+    
+    // bf16 / int8 operands through gemm_lowp.h, compared with the fp32 result
+    void reducedPrecisionMatrixMultiply(const float* A, const float* B, const float* reference,
+                                        double fp32_ms) {
+        const int n = static_cast<int>(MATRIX_SIZE);
+        const size_t count = MATRIX_SIZE * MATRIX_SIZE;
+        const auto blocking = hpc::gemmBlockingFor(L1_CACHE_SIZE, L2_CACHE_SIZE, L3_CACHE_SIZE);
+        std::pmr::vector<float> C(count);
+        
+        auto relativeError = [&]() {
+            float max_diff = 0.0f;
+            float max_value = 0.0f;
+            for (size_t i = 0; i < count; ++i) {
+                max_diff = std::max(max_diff, std::abs(reference[i] - C[i]));
+                max_value = std::max(max_value, std::abs(reference[i]));
+            }
+            return max_diff / std::max(max_value, 1e-30f);
+        };
+        
+        std::pmr::vector<uint16_t> A16(count);
+        std::pmr::vector<uint16_t> B16(count);
+        hpc::convertToBf16(n, n, A, n, A16.data(), n);
+        hpc::convertToBf16(n, n, B, n, B16.data(), n);
+        const double bf16_ms = hpc::benchmark("bf16 GEMM", count * MATRIX_SIZE, [&] {
+            hpc::gemmBf16(n, n, n, A16.data(), n, B16.data(), n, C.data(), n, false, blocking);
+        }).median * 1e3;
+        spdlog::info("bf16 GEMM ({}): {:.1f} ms ({:.2f}x vs fp32), operands {} MB, max rel. error {:.2e}",
+                    hpc::GEMM_BF16_KERNEL_NAME, bf16_ms, fp32_ms / bf16_ms,
+                    2 * count * sizeof(uint16_t) / (1024 * 1024), relativeError());
+        
+        std::pmr::vector<int8_t> A8(count);
+        std::pmr::vector<int8_t> B8(count);
+        std::pmr::vector<int32_t> C32(count);
+        float scale = hpc::quantizeInt8(n, n, A, n, A8.data(), n) * hpc::quantizeInt8(n, n, B, n, B8.data(), n);
+        const double int8_ms = hpc::benchmark("int8 GEMM", count * MATRIX_SIZE, [&] {
+            hpc::gemmInt8(n, n, n, A8.data(), n, B8.data(), n, C32.data(), n, false, blocking);
+        }).median * 1e3;
+        for (size_t i = 0; i < count; ++i) {
+            C[i] = scale * static_cast<float>(C32[i]);
+        }
+        spdlog::info("int8 GEMM ({}): {:.1f} ms ({:.2f}x vs fp32), operands {} MB, max rel. error {:.2e}",
+                    hpc::GEMM_INT8_KERNEL_NAME, int8_ms, fp32_ms / int8_ms,
+                    2 * count * sizeof(int8_t) / (1024 * 1024), relativeError());
     }
     
     // 2. Memory Access Patterns
     void memoryAccessPatterns() {
         spdlog::info("\n=== Memory Access Patterns ===");
         
-        auto data = std::make_unique<int[]>(ARRAY_SIZE);
+        hpc::HugePageArray<int> data(ARRAY_SIZE, &pool_);
+        data.parallelGenerate([](size_t i) { return static_cast<int>(i); });
         
-        // Initialize data
-        for (size_t i = 0; i < ARRAY_SIZE; ++i) {
-            data[i] = static_cast<int>(i);
-        }
-        
-        // Sequential access (cache-friendly)
-        auto start = std::chrono::high_resolution_clock::now();
-        long long sum1 = sequentialSum(data.get(), ARRAY_SIZE);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto seq_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        // Sequential access (cache-friendly); median times in μs
+        long long sum1 = 0;
+        const double seq_us = hpc::benchmark("Sequential access", ARRAY_SIZE, [&] {
+            sum1 = sequentialSum(data.data(), ARRAY_SIZE);
+        }).median * 1e6;
         
-        // Random access (cache-unfriendly)
-        start = std::chrono::high_resolution_clock::now();
-        long long sum2 = randomSum(data.get(), ARRAY_SIZE);
-        end = std::chrono::high_resolution_clock::now();
-        auto random_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        // Random access (cache-unfriendly); the permutation is built
+        // outside the timed region
+        std::pmr::vector<size_t> indices = shuffledIndices(ARRAY_SIZE);
+        long long sum2 = 0;
+        const double random_us = hpc::benchmark("Random access", ARRAY_SIZE, [&] {
+            sum2 = randomSum(data.data(), indices);
+        }).median * 1e6;
         
         // Strided access (varying cache behavior)
-        start = std::chrono::high_resolution_clock::now();
-        long long sum3 = stridedSum(data.get(), ARRAY_SIZE, 16);
-        end = std::chrono::high_resolution_clock::now();
-        auto strided_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        
-        spdlog::info("Sequential access: {} μs (sum: {})", seq_time.count(), sum1);
-        spdlog::info("Random access: {} μs (sum: {})", random_time.count(), sum2);
-        spdlog::info("Strided access (stride=16): {} μs (sum: {})", strided_time.count(), sum3);
-        spdlog::info("Random vs Sequential slowdown: {:.2f}x", 
-                    static_cast<double>(random_time.count()) / seq_time.count());
+        long long sum3 = 0;
+        const double strided_us = hpc::benchmark("Strided access", ARRAY_SIZE / 16, [&] {
+            sum3 = stridedSum(data.data(), ARRAY_SIZE, 16);
+        }).median * 1e6;
+        
+        spdlog::info("Sequential access: {:.0f} μs (sum: {})", seq_us, sum1);
+        spdlog::info("Random access: {:.0f} μs (sum: {})", random_us, sum2);
+        spdlog::info("Strided access (stride=16): {:.0f} μs (sum: {})", strided_us, sum3);
+        spdlog::info("Random vs Sequential slowdown: {:.2f}x", random_us / seq_us);
+        
+        gatherStrategies(data.data(), indices, sum1, seq_us);
+        pageSizeComparison(indices, sum1);
+    }
+    
+    // The same array on 4 KB and on 2 MB pages (huge_pages.h): parallel
+    // bandwidth and TLB-bound random reads. TLB entries is the number of
+    // entries needed to map the whole array. These two arrays are mapped
+    // directly rather than taken from the demo arena, whose pages are all
+    // huge.
+    void pageSizeComparison(const std::pmr::vector<size_t>& indices, long long expected) {
+        spdlog::info("\nPage size ({} MB array, parallel first touch):", ARRAY_SIZE * sizeof(int) / (1024 * 1024));
+        
+        for (auto policy : {hpc::PagePolicy::Regular, hpc::PagePolicy::Huge}) {
+            // Every first touch maps a fresh array; unmapping the previous
+            // one is setup, outside the timed call
+            std::optional<hpc::HugePageArray<int>> mapped;
+            const std::string label = policy == hpc::PagePolicy::Huge ? "huge pages" : "regular pages";
+            const double touch_us = hpc::benchmark("First touch, " + label, ARRAY_SIZE, [&] {
+                mapped.emplace(ARRAY_SIZE, policy);
+                mapped->parallelGenerate([](size_t i) { return static_cast<int>(i); });
+            }, [&] { mapped.reset(); }).median * 1e6;
+            const hpc::HugePageArray<int>& data = *mapped;
+            
+            const long long n = static_cast<long long>(data.size());
+            const int* values = data.data();
+            long long sum = 0;
+            const double seq_us = hpc::benchmark("Parallel sum, " + label, n, [&] {
+                long long partial = 0;
+                #pragma omp parallel for schedule(static) reduction(+:partial)
+                for (long long i = 0; i < n; ++i) {
+                    partial += values[i];
+                }
+                sum = partial;
+            }).median * 1e6;
+            
+            long long random_sum = 0;
+            const double random_us = hpc::benchmark("Random access, " + label, indices.size(), [&] {
+                random_sum = randomSum(values, indices);
+            }).median * 1e6;
+            
+            const size_t huge_bytes = data.hugePageBytes();
+            const size_t small_bytes = data.size() * sizeof(int) - std::min(data.size() * sizeof(int), huge_bytes);
+            const size_t tlb_entries = huge_bytes / hpc::HUGE_PAGE_SIZE + (small_bytes + 4095) / 4096;
+            spdlog::info("  {:<24} huge {:4} MB, {:6} TLB entries, first touch {:6.0f} μs, "
+                        "sequential {:5.1f} GB/s, random {:6.0f} μs{}",
+                        hpc::pageBackingName(data.backing()), huge_bytes / (1024 * 1024), tlb_entries, touch_us,
+                        static_cast<double>(n * sizeof(int)) / seq_us / 1e3, random_us,
+                        sum == expected && random_sum == expected ? "" : " (sum mismatch)");
+        }
+    }
+    
+    // Random reads through the gather engine (gather.h): how much of the
+    // sequential throughput each strategy recovers
+    void gatherStrategies(const int* data, const std::pmr::vector<size_t>& indices,
+                          long long expected, double seq_us) {
+        spdlog::info("\nGather engine over the same permutation (hardware: {}):", hpc::GATHER_HARDWARE_NAME);
+        
+        // Median μs of one gather sum
+        auto timeSum = [&](const std::string& label, const hpc::GatherOptions& options) {
+            long long sum = 0;
+            const double us = hpc::benchmark("Gather, " + label, indices.size(), [&] {
+                sum = hpc::gatherSum<long long>(data, indices.data(), indices.size(), options);
+            }).median * 1e6;
+            if (sum != expected) {
+                spdlog::error("{} gather sum mismatch: {} vs {}",
+                             hpc::gatherStrategyName(options.strategy), sum, expected);
+            }
+            return us;
+        };
+        auto report = [&](const std::string& label, double us) {
+            spdlog::info("  {:<28} {:>8.0f} μs  {:6.1f} M elem/s  {:5.1f}% of sequential",
+                        label, us, static_cast<double>(indices.size()) / us, 100.0 * seq_us / us);
+        };
+        
+        for (auto strategy : {hpc::GatherStrategy::Direct, hpc::GatherStrategy::Prefetch,
+                              hpc::GatherStrategy::GroupPrefetch, hpc::GatherStrategy::PageBucketed,
+                              hpc::GatherStrategy::Hardware}) {
+            hpc::GatherOptions options;
+            options.strategy = strategy;
+            report(hpc::gatherStrategyName(strategy), timeSum(hpc::gatherStrategyName(strategy), options));
+        }
+        
+        // Prefetch distance has to cover memory latency / time per element
+        spdlog::info("Prefetch distance sweep:");
+        for (size_t distance : {4, 16, 32, 64, 128, 256}) {
+            hpc::GatherOptions options;
+            options.strategy = hpc::GatherStrategy::Prefetch;
+            options.distance = distance;
+            const std::string label = "distance " + std::to_string(distance);
+            report(label, timeSum(label, options));
+        }
     }
     
     // 3. Data Structure of Arrays vs Array of Structures
@@ -110,23 +306,16 @@ public:
             float mass;
         };
         
-        auto particles_aos = std::make_unique<Particle_AoS[]>(N);
+        std::pmr::vector<Particle_AoS> particles_aos(N);
         
-        // Structure of Arrays (SoA) - cache-friendly approach
-        struct Particles_SoA {
-            std::unique_ptr<float[]> x, y, z;
-            std::unique_ptr<float[]> vx, vy, vz;
-            std::unique_ptr<float[]> mass;
-            
-            Particles_SoA(size_t n) :
-                x(std::make_unique<float[]>(n)),
-                y(std::make_unique<float[]>(n)),
-                z(std::make_unique<float[]>(n)),
-                vx(std::make_unique<float[]>(n)),
-                vy(std::make_unique<float[]>(n)),
-                vz(std::make_unique<float[]>(n)),
-                mass(std::make_unique<float[]>(n)) {}
-        } particles_soa(N);
+        // Structure of Arrays (SoA) - cache-friendly approach, and the
+        // tiled AoSoA variant (blocks of SIMD-width records, see soa.h)
+        using Particles_SoA = hpc::SoA<Particle_AoS, &Particle_AoS::x, &Particle_AoS::y, &Particle_AoS::z,
+                                       &Particle_AoS::vx, &Particle_AoS::vy, &Particle_AoS::vz,
+                                       &Particle_AoS::mass>;
+        using Particles_AoSoA = hpc::AoSoA<Particle_AoS, &Particle_AoS::x, &Particle_AoS::y, &Particle_AoS::z,
+                                           &Particle_AoS::vx, &Particle_AoS::vy, &Particle_AoS::vz,
+                                           &Particle_AoS::mass>;
         
         // Initialize data
         std::mt19937 rng(42);
@@ -135,41 +324,83 @@ public:
         for (size_t i = 0; i < N; ++i) {
             particles_aos[i] = {dist(rng), dist(rng), dist(rng), 
                                dist(rng), dist(rng), dist(rng), 1.0f};
-            
-            particles_soa.x[i] = particles_aos[i].x;
-            particles_soa.y[i] = particles_aos[i].y;
-            particles_soa.z[i] = particles_aos[i].z;
-            particles_soa.vx[i] = particles_aos[i].vx;
-            particles_soa.vy[i] = particles_aos[i].vy;
-            particles_soa.vz[i] = particles_aos[i].vz;
-            particles_soa.mass[i] = particles_aos[i].mass;
         }
+        Particles_SoA particles_soa(N);
+        Particles_AoSoA particles_aosoa(N);
+        particles_soa.fromAoS(particles_aos.data());
+        particles_aosoa.fromAoS(particles_aos.data());
         
         const float dt = 0.01f;
+        const std::pmr::vector<Particle_AoS> initial = particles_aos;
         
         // AoS update (poor cache locality for partial updates)
-        auto start = std::chrono::high_resolution_clock::now();
-        for (size_t i = 0; i < N; ++i) {
-            particles_aos[i].x += particles_aos[i].vx * dt;
-            particles_aos[i].y += particles_aos[i].vy * dt;
-            particles_aos[i].z += particles_aos[i].vz * dt;
-        }
-        auto end = std::chrono::high_resolution_clock::now();
-        auto aos_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        auto aos_step = [&] {
+            for (size_t i = 0; i < N; ++i) {
+                particles_aos[i].x += particles_aos[i].vx * dt;
+                particles_aos[i].y += particles_aos[i].vy * dt;
+                particles_aos[i].z += particles_aos[i].vz * dt;
+            }
+        };
         
         // SoA update (excellent cache locality)
-        start = std::chrono::high_resolution_clock::now();
+        float* x = particles_soa.data<&Particle_AoS::x>();
+        float* y = particles_soa.data<&Particle_AoS::y>();
+        float* z = particles_soa.data<&Particle_AoS::z>();
+        const float* vx = particles_soa.data<&Particle_AoS::vx>();
+        const float* vy = particles_soa.data<&Particle_AoS::vy>();
+        const float* vz = particles_soa.data<&Particle_AoS::vz>();
+        auto soa_step = [&] {
+            for (size_t i = 0; i < N; ++i) {
+                x[i] += vx[i] * dt;
+                y[i] += vy[i] * dt;
+                z[i] += vz[i] * dt;
+            }
+        };
+        
+        // AoSoA update: one SIMD-width chunk at a time, every field of the
+        // chunk in adjacent cache lines
+        auto aosoa_step = [&] {
+            particles_aosoa.forEachChunk([&](auto chunk) {
+                float* cx = chunk.template data<&Particle_AoS::x>();
+                float* cy = chunk.template data<&Particle_AoS::y>();
+                float* cz = chunk.template data<&Particle_AoS::z>();
+                const float* cvx = chunk.template data<&Particle_AoS::vx>();
+                const float* cvy = chunk.template data<&Particle_AoS::vy>();
+                const float* cvz = chunk.template data<&Particle_AoS::vz>();
+                for (size_t l = 0; l < Particles_AoSoA::chunk_size; ++l) {
+                    cx[l] += cvx[l] * dt;
+                    cy[l] += cvy[l] * dt;
+                    cz[l] += cvz[l] * dt;
+                }
+            });
+        };
+        
+        // Median μs per step (benchmark.h)
+        const double aos_us = hpc::benchmark("AoS position update", N, aos_step).median * 1e6;
+        const double soa_us = hpc::benchmark("SoA position update", N, soa_step).median * 1e6;
+        const double aosoa_us = hpc::benchmark("AoSoA position update", N, aosoa_step).median * 1e6;
+        
+        // The layouts took different numbers of steps while being timed;
+        // one step from the same start must give the same particles
+        particles_aos.assign(initial.begin(), initial.end());
+        particles_soa.fromAoS(initial.data());
+        particles_aosoa.fromAoS(initial.data());
+        aos_step();
+        soa_step();
+        aosoa_step();
+        float max_diff = 0.0f;
         for (size_t i = 0; i < N; ++i) {
-            particles_soa.x[i] += particles_soa.vx[i] * dt;
-            particles_soa.y[i] += particles_soa.vy[i] * dt;
-            particles_soa.z[i] += particles_soa.vz[i] * dt;
+            Particle_AoS tiled = particles_aosoa[i];
+            max_diff = std::max({max_diff, std::abs(particles_aos[i].x - x[i]),
+                                 std::abs(particles_aos[i].z - tiled.z)});
         }
-        end = std::chrono::high_resolution_clock::now();
-        auto soa_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
         
-        spdlog::info("AoS position update: {} μs", aos_time.count());
-        spdlog::info("SoA position update: {} μs", soa_time.count());
-        spdlog::info("SoA speedup: {:.2f}x", static_cast<double>(aos_time.count()) / soa_time.count());
+        spdlog::info("AoS position update: {:.0f} μs", aos_us);
+        spdlog::info("SoA position update: {:.0f} μs", soa_us);
+        spdlog::info("AoSoA position update ({}-wide blocks): {:.0f} μs", Particles_AoSoA::chunk_size, aosoa_us);
+        spdlog::info("SoA speedup: {:.2f}x", aos_us / soa_us);
+        spdlog::info("AoSoA speedup: {:.2f}x", aos_us / aosoa_us);
+        spdlog::info("Max difference between layouts: {:.6f}", max_diff);
     }
     
     // 4. Memory Alignment and Padding
@@ -194,39 +425,67 @@ public:
             double d;
         };
         
+        // Same fields, order chosen at compile time (packed_record.h), and
+        // a hot/cold split with the scanned field d alone in the hot array
+        using PackedStruct = hpc::PackedRecord<UnalignedStruct, &UnalignedStruct::a, &UnalignedStruct::b,
+                                               &UnalignedStruct::c, &UnalignedStruct::d>;
+        using SplitArray = hpc::HotColdArray<UnalignedStruct, hpc::FieldList<&UnalignedStruct::d>,
+                                             hpc::FieldList<&UnalignedStruct::a, &UnalignedStruct::b,
+                                                            &UnalignedStruct::c>>;
+        static_assert(sizeof(PackedStruct) == 16 && PackedStruct::padding_bytes == 2,
+                      "a, b, c, d pack into 16 bytes");
+        static_assert(sizeof(SplitArray::HotRecord) == sizeof(double), "hot array holds only d");
+        static_assert(sizeof(PackedStruct) < sizeof(UnalignedStruct), "packing must beat declaration order");
+        
         spdlog::info("Unaligned struct size: {} bytes", sizeof(UnalignedStruct));
         spdlog::info("Aligned struct size: {} bytes", sizeof(AlignedStruct));
+        spdlog::info("Packed record size: {} bytes ({} payload, d at offset {})", sizeof(PackedStruct),
+                    PackedStruct::payload_bytes, PackedStruct::offset<&UnalignedStruct::d>());
         spdlog::info("Cache line size: {} bytes", CACHE_LINE_SIZE);
         
         const size_t N = 1000000;
-        auto unaligned_array = std::make_unique<UnalignedStruct[]>(N);
-        auto aligned_array = std::make_unique<AlignedStruct[]>(N);
+        std::pmr::vector<UnalignedStruct> unaligned_array(N);
+        std::pmr::vector<AlignedStruct> aligned_array(N);
+        std::pmr::vector<PackedStruct> packed_array(N);
+        SplitArray split_array(N);
         
         // Initialize
         for (size_t i = 0; i < N; ++i) {
             unaligned_array[i] = {'x', static_cast<int>(i), 'y', static_cast<double>(i)};
             aligned_array[i] = {'x', {}, static_cast<int>(i), 'y', {}, static_cast<double>(i)};
+            packed_array[i].store(unaligned_array[i]);
+            split_array.store(i, unaligned_array[i]);
         }
         
-        // Access patterns
-        auto start = std::chrono::high_resolution_clock::now();
-        double sum1 = 0.0;
-        for (size_t i = 0; i < N; ++i) {
-            sum1 += unaligned_array[i].d;
-        }
-        auto end = std::chrono::high_resolution_clock::now();
-        auto unaligned_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        
-        start = std::chrono::high_resolution_clock::now();
-        double sum2 = 0.0;
-        for (size_t i = 0; i < N; ++i) {
-            sum2 += aligned_array[i].d;
-        }
-        end = std::chrono::high_resolution_clock::now();
-        auto aligned_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        // Scan of d: median μs of repeated passes, so every layout is
+        // measured warm (benchmark.h)
+        auto scan = [&](const char* name, auto&& read) {
+            double sum = 0.0;
+            const double us = hpc::benchmark(name, N, [&] {
+                double partial = 0.0;
+                for (size_t i = 0; i < N; ++i) {
+                    partial += read(i);
+                }
+                sum = partial;
+            }).median * 1e6;
+            return std::make_pair(us, sum);
+        };
+        auto report = [&](const char* name, size_t record_bytes, auto&& read) {
+            const auto result = scan(name, read);
+            spdlog::info("  {:<22} {:>3} B/record {:5.2f} records/line {:8.0f} μs {:7.1f} Mrecords/s (sum: {:.2f})",
+                        name, record_bytes, static_cast<double>(CACHE_LINE_SIZE) / record_bytes,
+                        result.first, N / result.first, result.second);
+        };
         
-        spdlog::info("Unaligned access time: {} μs (sum: {:.2f})", unaligned_time.count(), sum1);
-        spdlog::info("Aligned access time: {} μs (sum: {:.2f})", aligned_time.count(), sum2);
+        spdlog::info("Scan of d over {} records:", N);
+        report("Unaligned struct", sizeof(UnalignedStruct),
+               [&](size_t i) { return unaligned_array[i].d; });
+        report("Aligned struct", sizeof(AlignedStruct),
+               [&](size_t i) { return aligned_array[i].d; });
+        report("Packed record", sizeof(PackedStruct),
+               [&](size_t i) { return packed_array[i].get<&UnalignedStruct::d>(); });
+        report("Hot/cold split (hot)", sizeof(SplitArray::HotRecord),
+               [&](size_t i) { return split_array.hot(i).get<&UnalignedStruct::d>(); });
     }
     
     // 5. Cache Blocking (Tiling) Demonstration
@@ -234,58 +493,129 @@ public:
         spdlog::info("\n=== Cache Blocking (Tiling) ===");
         
         const size_t N = 2048;
-        auto A = std::make_unique<float[]>(N * N);
-        auto B = std::make_unique<float[]>(N * N);
+        hpc::HugePageArray<float> A(N * N, &pool_), B(N * N, &pool_);
         
         // Initialize
-        for (size_t i = 0; i < N * N; ++i) {
-            A[i] = 1.0f;
-            B[i] = 0.0f;
-        }
-        
-        // Matrix transpose without blocking
-        auto start = std::chrono::high_resolution_clock::now();
-        for (size_t i = 0; i < N; ++i) {
-            for (size_t j = 0; j < N; ++j) {
-                B[j * N + i] = A[i * N + j];
+        A.parallelFill(1.0f);
+        B.parallelFill(0.0f);
+        
+        // Matrix transpose without blocking; median times in ms
+        const double naive_ms = hpc::benchmark("Naive transpose", N * N, [&] {
+            for (size_t i = 0; i < N; ++i) {
+                for (size_t j = 0; j < N; ++j) {
+                    B[j * N + i] = A[i * N + j];
+                }
             }
-        }
-        auto end = std::chrono::high_resolution_clock::now();
-        auto naive_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        }).median * 1e3;
         
         // Reset B
-        std::fill_n(B.get(), N * N, 0.0f);
+        std::fill_n(B.data(), N * N, 0.0f);
         
         // Matrix transpose with cache blocking
-        const size_t BLOCK_SIZE = 64;
-        start = std::chrono::high_resolution_clock::now();
-        for (size_t ii = 0; ii < N; ii += BLOCK_SIZE) {
-            for (size_t jj = 0; jj < N; jj += BLOCK_SIZE) {
-                for (size_t i = ii; i < std::min(ii + BLOCK_SIZE, N); ++i) {
-                    for (size_t j = jj; j < std::min(jj + BLOCK_SIZE, N); ++j) {
-                        B[j * N + i] = A[i * N + j];
+        // Source and destination tiles together fill L1, rounded to whole lines
+        const size_t floats_per_line = CACHE_LINE_SIZE / sizeof(float);
+        const size_t l1_tile = static_cast<size_t>(std::sqrt(L1_CACHE_SIZE / (2.0 * sizeof(float))));
+        const size_t BLOCK_SIZE = std::max(floats_per_line, l1_tile / floats_per_line * floats_per_line);
+        const double blocked_ms = hpc::benchmark("Cache-blocked transpose", N * N, [&] {
+            for (size_t ii = 0; ii < N; ii += BLOCK_SIZE) {
+                for (size_t jj = 0; jj < N; jj += BLOCK_SIZE) {
+                    for (size_t i = ii; i < std::min(ii + BLOCK_SIZE, N); ++i) {
+                        for (size_t j = jj; j < std::min(jj + BLOCK_SIZE, N); ++j) {
+                            B[j * N + i] = A[i * N + j];
+                        }
                     }
                 }
             }
-        }
-        end = std::chrono::high_resolution_clock::now();
-        auto blocked_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        }).median * 1e3;
+        
+        // Same blocking, but each tile is transposed in SIMD registers
+        std::fill_n(B.data(), N * N, 0.0f);
+        const double simd_ms = hpc::benchmark("SIMD transpose", N * N, [&] {
+            hpc::transpose(A.data(), static_cast<int>(N), B.data(), static_cast<int>(N),
+                           static_cast<int>(N), static_cast<int>(N), static_cast<int>(BLOCK_SIZE));
+        }).median * 1e3;
+        
+        spdlog::info("Matrix transpose ({}x{}, {}x{} blocks):", N, N, BLOCK_SIZE, BLOCK_SIZE);
+        spdlog::info("  Naive approach: {:.2f} ms", naive_ms);
+        spdlog::info("  Cache-blocked approach: {:.2f} ms", blocked_ms);
+        spdlog::info("  SIMD {} tile approach: {:.2f} ms", hpc::TRANSPOSE_KERNEL_NAME, simd_ms);
+        spdlog::info("  Speedup: {:.2f}x", naive_ms / blocked_ms);
+        spdlog::info("  SIMD speedup: {:.2f}x", naive_ms / simd_ms);
+    }
+    
+    // 6. Multi-step particle integrator: SoA + omp parallel for simd, with
+    //    and without periodic Morton (Z-order) re-sorting
+    void particleIntegratorDemo() {
+        spdlog::info("\n=== Particle Integrator (SoA, OpenMP, Morton order) ===");
+        
+        const size_t n = 1 << 20;
+        const int steps = 20;
+        const int resort_interval = 5;
+#ifdef _OPENMP
+        const int threads = omp_get_max_threads();
+#else
+        const int threads = 1;
+#endif
         
-        spdlog::info("Matrix transpose ({}x{}):", N, N);
-        spdlog::info("  Naive approach: {} ms", naive_time.count());
-        spdlog::info("  Cache-blocked approach: {} ms", blocked_time.count());
-        spdlog::info("  Speedup: {:.2f}x", static_cast<double>(naive_time.count()) / blocked_time.count());
+        ParticleSoA initial(n);
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(0.0f, 1.0f);
+        std::normal_distribution<float> velocity(0.0f, 0.05f);
+        for (size_t i = 0; i < n; ++i) {
+            initial[i] = Particle{position(rng), position(rng), position(rng),
+                                  velocity(rng), velocity(rng), velocity(rng), 1.0f};
+        }
+        spdlog::info("{} particles, {} steps, {}^3 cells, {} threads", n, steps, PARTICLE_GRID, threads);
+        
+        ParticleSoA random_order = initial;
+        ParticleSoA morton_order = initial;
+        double random_seconds = 0.0, random_sort_seconds = 0.0;
+        double morton_seconds = 0.0, morton_sort_seconds = 0.0;
+        std::vector<double> random_steps, morton_steps;
+        {
+            hpc::PerfRegion counters("Integrator, random order", n * steps);
+            runIntegrator(random_order, steps, 0, random_seconds, random_sort_seconds, random_steps);
+        }
+        {
+            hpc::PerfRegion counters("Integrator, Morton order", n * steps);
+            runIntegrator(morton_order, steps, resort_interval, morton_seconds, morton_sort_seconds, morton_steps);
+        }
+        // A simulation cannot be rerun step by step, so its steps are the
+        // samples; the re-sorting steps show in the Morton p99
+        const hpc::BenchStats random_stats = hpc::benchRecord("Integrator step, random order", n, random_steps);
+        const hpc::BenchStats morton_stats = hpc::benchRecord("Integrator step, Morton order", n, morton_steps);
+        
+        spdlog::info("Random order:             {:.1f} steps/s", steps / random_seconds);
+        spdlog::info("Morton re-sort every {:2}: {:.1f} steps/s (sorting {:.1f}% of the time)",
+                    resort_interval, steps / morton_seconds, 100.0 * morton_sort_seconds / morton_seconds);
+        spdlog::info("Median step: {:.1f} ms (random) vs {:.1f} ms (Morton, p99 {:.1f} ms)",
+                    random_stats.median * 1e3, morton_stats.median * 1e3, morton_stats.p99 * 1e3);
+        spdlog::info("Re-sorting gain: {:.2f}x", random_seconds / morton_seconds);
+        spdlog::info("Kinetic energy after {} steps: {:.6f} (random) vs {:.6f} (Morton)",
+                    steps, kineticEnergy(random_order), kineticEnergy(morton_order));
     }
     
     void runAllDemos() {
         spdlog::info("=== Memory Optimization and Cache Performance ===");
-        spdlog::info("Demonstrating the impact of memory access patterns on performance\n");
-        
-        matrixMultiplicationComparison();
-        memoryAccessPatterns();
-        soaVsAosComparison();
-        memoryAlignmentDemo();
-        cacheBlockingDemo();
+        spdlog::info("Demonstrating the impact of memory access patterns on performance");
+        spdlog::info("{}", hpc::describeCacheTopology(hpc::cacheTopology()));
+        spdlog::info("Performance counters: {}", hpc::perfCounters().describe());
+        
+        runDemo("Matrix multiplication", &MemoryOptimizationDemo::matrixMultiplicationComparison);
+        runDemo("Access patterns", &MemoryOptimizationDemo::memoryAccessPatterns);
+        runDemo("SoA vs AoS", &MemoryOptimizationDemo::soaVsAosComparison);
+        runDemo("Alignment", &MemoryOptimizationDemo::memoryAlignmentDemo);
+        runDemo("Cache blocking", &MemoryOptimizationDemo::cacheBlockingDemo);
+        runDemo("Particle integrator", &MemoryOptimizationDemo::particleIntegratorDemo);
+        
+        spdlog::info("\n=== Memory per Demo (arena{}) ===",
+                    arena_.budget() ? fmt::format(", budget {} MB", arena_.budget() / (1024 * 1024)) : "");
+        spdlog::info("{:<22} {:>10} {:>12} {:>12} {:>12}", "Demo", "Peak MB", "Allocations", "Alloc ms", "Reserved MB");
+        for (const auto& demo : demo_memory_) {
+            spdlog::info("{:<22} {:>10.1f} {:>12} {:>12.2f} {:>12.1f}", demo.name,
+                        demo.pool.peak_bytes / 1048576.0, demo.pool.allocations,
+                        demo.pool.seconds * 1e3, demo.reserved_bytes / 1048576.0);
+        }
         
         spdlog::info("\n=== Memory Optimization Summary ===");
         spdlog::info("• Cache locality is crucial for performance");
@@ -297,6 +627,22 @@ public:
     }
 
 private:
+    // Runs one demo against a freshly reset arena and pool and records its
+    // peak memory, allocation count and time spent allocating
+    void runDemo(const std::string& name, void (MemoryOptimizationDemo::*demo)()) {
+        pool_.reset();
+        arena_.reset();
+        try {
+            hpc::ScopedDefaultResource scope(&pool_);
+            (this->*demo)();
+        } catch (const std::bad_alloc&) {
+            spdlog::warn("{} does not fit the {} MB memory budget", name, arena_.budget() / (1024 * 1024));
+        }
+        demo_memory_.push_back({name, pool_.stats(), arena_.stats().reserved_bytes});
+        spdlog::info("[memory] peak {:.1f} MB, {} allocations, {:.2f} ms allocating",
+                    pool_.stats().peak_bytes / 1048576.0, pool_.stats().allocations, pool_.stats().seconds * 1e3);
+    }
+    
     // Naive matrix multiplication (i-j-k order)
     void naiveMatrixMultiply(const float* A, const float* B, float* C, size_t n) {
         for (size_t i = 0; i < n; ++i) {
@@ -325,6 +671,13 @@ private:
         }
     }
     
+    // Packed-panel GEMM engine from gemm.h
+    void packedMatrixMultiply(const float* A, const float* B, float* C, size_t n) {
+        int dim = static_cast<int>(n);
+        hpc::gemm(dim, dim, dim, A, dim, B, dim, C, dim, false,
+                  hpc::gemmBlockingFor(L1_CACHE_SIZE, L2_CACHE_SIZE, L3_CACHE_SIZE));
+    }
+    
     long long sequentialSum(const int* data, size_t size) {
         long long sum = 0;
         for (size_t i = 0; i < size; ++i) {
@@ -333,20 +686,191 @@ private:
         return sum;
     }
     
-    long long randomSum(const int* data, size_t size) {
-        std::vector<size_t> indices(size);
+    std::pmr::vector<size_t> shuffledIndices(size_t size) {
+        std::pmr::vector<size_t> indices(size);
         std::iota(indices.begin(), indices.end(), 0);
         
         std::mt19937 rng(42);
         std::shuffle(indices.begin(), indices.end(), rng);
-        
+        return indices;
+    }
+    
+    long long randomSum(const int* data, const std::pmr::vector<size_t>& indices) {
         long long sum = 0;
-        for (size_t i = 0; i < size; ++i) {
+        for (size_t i = 0; i < indices.size(); ++i) {
             sum += data[indices[i]];
         }
         return sum;
     }
     
+    // Interleave the low 10 bits of x, y, z: 30-bit Z-order key
+    static uint32_t mortonKey(uint32_t x, uint32_t y, uint32_t z) {
+        auto spread = [](uint32_t v) {
+            v &= 0x3FF;
+            v = (v | (v << 16)) & 0x030000FF;
+            v = (v | (v << 8)) & 0x0300F00F;
+            v = (v | (v << 4)) & 0x030C30C3;
+            v = (v | (v << 2)) & 0x09249249;
+            return v;
+        };
+        return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+    }
+    
+    // Reorder particles along the Z-order curve of their positions
+    void sortByMorton(ParticleSoA& particles) {
+        const size_t n = particles.size();
+        const float* x = particles.data<&Particle::x>();
+        const float* y = particles.data<&Particle::y>();
+        const float* z = particles.data<&Particle::z>();
+        
+        // Key in the high 32 bits, original index in the low 32
+        std::pmr::vector<uint64_t> keyed(n);
+        #pragma omp parallel for simd
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t key = mortonKey(static_cast<uint32_t>(x[i] * 1024.0f),
+                                     static_cast<uint32_t>(y[i] * 1024.0f),
+                                     static_cast<uint32_t>(z[i] * 1024.0f));
+            keyed[i] = (static_cast<uint64_t>(key) << 32) | i;
+        }
+        std::sort(keyed.begin(), keyed.end());
+        
+        ParticleSoA sorted(n);
+        #pragma omp parallel for
+        for (size_t i = 0; i < n; ++i) {
+            sorted[i] = particles[keyed[i] & 0xFFFFFFFFu];
+        }
+        particles = std::move(sorted);
+    }
+    
+    // steps of: cell list -> forces from the 3x3x3 cells around each
+    // particle -> velocity/position update. Re-sorts every resort_interval
+    // steps (0 = never). Total and sorting wall time are returned in
+    // seconds, and the time of every step (sorting included) in step_seconds.
+    void runIntegrator(ParticleSoA& particles, int steps, int resort_interval,
+                       double& total_seconds, double& sort_seconds, std::vector<double>& step_seconds) {
+        const size_t n = particles.size();
+        const int G = PARTICLE_GRID;
+        const size_t cells = static_cast<size_t>(G) * G * G;
+        const float cutoff = 1.0f / G;
+        const float cutoff2 = cutoff * cutoff;
+        const float stiffness = 1.0f / cutoff2;
+        const float dt = 0.001f;
+        // The cutoff equals the cell width, so partners can be in any cell
+        // sharing a face, edge or corner with the own one
+        int offsets[27][3];
+        for (int o = 0; o < 27; ++o) {
+            offsets[o][0] = o % 3 - 1;
+            offsets[o][1] = o / 3 % 3 - 1;
+            offsets[o][2] = o / 9 - 1;
+        }
+        
+        std::pmr::vector<uint32_t> cell_of(n), cell_start(cells + 1), cell_particles(n);
+        std::pmr::vector<float> ax(n), ay(n), az(n);
+        sort_seconds = 0.0;
+        step_seconds.clear();
+        
+        auto cellIndex = [G](float v) { return std::min(G - 1, static_cast<int>(v * G)); };
+        auto wrapCell = [G](int c) { return (c + G) % G; };
+        
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            auto step_begin = std::chrono::high_resolution_clock::now();
+            if (resort_interval > 0 && step % resort_interval == 0) {
+                auto sort_begin = std::chrono::high_resolution_clock::now();
+                sortByMorton(particles);
+                sort_seconds += std::chrono::duration<double>(
+                    std::chrono::high_resolution_clock::now() - sort_begin).count();
+            }
+            float* x = particles.data<&Particle::x>();
+            float* y = particles.data<&Particle::y>();
+            float* z = particles.data<&Particle::z>();
+            float* vx = particles.data<&Particle::vx>();
+            float* vy = particles.data<&Particle::vy>();
+            float* vz = particles.data<&Particle::vz>();
+            const float* mass = particles.data<&Particle::mass>();
+            
+            // Cell list by counting sort; cell_particles keeps memory order
+            // within a cell, so sorted particles give contiguous runs
+            #pragma omp parallel for simd
+            for (size_t i = 0; i < n; ++i) {
+                cell_of[i] = static_cast<uint32_t>((cellIndex(z[i]) * G + cellIndex(y[i])) * G + cellIndex(x[i]));
+            }
+            std::fill(cell_start.begin(), cell_start.end(), 0u);
+            for (size_t i = 0; i < n; ++i) {
+                ++cell_start[cell_of[i] + 1];
+            }
+            for (size_t c = 0; c < cells; ++c) {
+                cell_start[c + 1] += cell_start[c];
+            }
+            {
+                std::pmr::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+                for (size_t i = 0; i < n; ++i) {
+                    cell_particles[fill[cell_of[i]]++] = static_cast<uint32_t>(i);
+                }
+            }
+            
+            // Forces: soft repulsion (cutoff^2 - r^2) along the minimum-image
+            // separation, from particles in the own and 26 adjacent cells
+            #pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < n; ++i) {
+                const float xi = x[i], yi = y[i], zi = z[i];
+                const int cx = cellIndex(xi), cy = cellIndex(yi), cz = cellIndex(zi);
+                float fx = 0.0f, fy = 0.0f, fz = 0.0f;
+                for (const auto& offset : offsets) {
+                    size_t c = (static_cast<size_t>(wrapCell(cz + offset[2])) * G + wrapCell(cy + offset[1])) * G
+                             + wrapCell(cx + offset[0]);
+                    const uint32_t first = cell_start[c], last = cell_start[c + 1];
+                    #pragma omp simd reduction(+:fx, fy, fz)
+                    for (uint32_t k = first; k < last; ++k) {
+                        const uint32_t j = cell_particles[k];
+                        float dx = xi - x[j], dy = yi - y[j], dz = zi - z[j];
+                        dx -= std::nearbyint(dx);
+                        dy -= std::nearbyint(dy);
+                        dz -= std::nearbyint(dz);
+                        const float r2 = dx * dx + dy * dy + dz * dz;
+                        const float s = (r2 < cutoff2 && j != i) ? stiffness * (cutoff2 - r2) : 0.0f;
+                        fx += s * dx;
+                        fy += s * dy;
+                        fz += s * dz;
+                    }
+                }
+                ax[i] = fx / mass[i];
+                ay[i] = fy / mass[i];
+                az[i] = fz / mass[i];
+            }
+            
+            // Semi-implicit Euler, positions wrapped back into [0, 1)
+            #pragma omp parallel for simd
+            for (size_t i = 0; i < n; ++i) {
+                vx[i] += ax[i] * dt;
+                vy[i] += ay[i] * dt;
+                vz[i] += az[i] * dt;
+                x[i] += vx[i] * dt;
+                y[i] += vy[i] * dt;
+                z[i] += vz[i] * dt;
+                x[i] -= std::floor(x[i]);
+                y[i] -= std::floor(y[i]);
+                z[i] -= std::floor(z[i]);
+            }
+            step_seconds.push_back(std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - step_begin).count());
+        }
+        total_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+    
+    double kineticEnergy(const ParticleSoA& particles) {
+        const float* vx = particles.data<&Particle::vx>();
+        const float* vy = particles.data<&Particle::vy>();
+        const float* vz = particles.data<&Particle::vz>();
+        const float* mass = particles.data<&Particle::mass>();
+        double energy = 0.0;
+        #pragma omp parallel for reduction(+:energy)
+        for (size_t i = 0; i < particles.size(); ++i) {
+            energy += 0.5 * mass[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+        }
+        return energy;
+    }
+    
     long long stridedSum(const int* data, size_t size, size_t stride) {
         long long sum = 0;
         for (size_t i = 0; i < size; i += stride) {
@@ -356,12 +880,33 @@ private:
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
     try {
         spdlog::info("Starting Memory Optimization Demo");
         
-        MemoryOptimizationDemo demo;
+        // --json PATH, --pin CPUS, --bench-time S, --bench-ci F: see
+        // benchmark.h. Pin before OpenMP starts its workers.
+        const hpc::BenchConfig bench_config = hpc::parseBenchArgs(argc, argv);
+        hpc::configureBench(bench_config);
+        hpc::setBenchSink([](const hpc::BenchStats& stats) { spdlog::info("  [bench] {}", stats.summary()); });
+        
+        // Open the counters before OpenMP starts its workers
+        hpc::perfCounters();
+        hpc::setPerfSink([](const hpc::PerfReport& report) { spdlog::info("  [counters] {}", report.summary()); });
+        
+        // --budget-mb N: fail demos that need more than N MB of arena memory
+        size_t budget = 0;
+        for (int i = 1; i + 1 < argc; ++i) {
+            if (std::string(argv[i]) == "--budget-mb") {
+                budget = std::stoull(argv[i + 1]) * 1024 * 1024;
+            }
+        }
+        MemoryOptimizationDemo demo(budget);
         demo.runAllDemos();
+        if (!bench_config.json_path.empty()) {
+            hpc::writeBenchJson(bench_config.json_path);
+            spdlog::info("Benchmark results written to {}", bench_config.json_path);
+        }
         
         spdlog::info("\nMemory Optimization Demo completed successfully!");
         
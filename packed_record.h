@@ -0,0 +1,215 @@
+#pragma once
+
+// Records laid out at compile time with the least padding.
+//
+// A hand-padded struct fixes its field order by hand and usually its
+// padding too; alignas(64) on a 14-byte record turns every element into a
+// full cache line of which 50 bytes are never read. PackedRecord takes the
+// field list as pointers to members of an ordinary struct, exactly like
+// SoA (soa.h),
+//
+//   struct Order { char side; int qty; char flag; double price; };
+//   hpc::PackedRecord<Order, &Order::side, &Order::qty, &Order::flag,
+//                     &Order::price>                       // 16 bytes, not 24
+//
+// and stores the fields in order of decreasing alignment, which for the
+// power-of-two alignments of scalar types leaves padding only at the end
+// (the minimum: size rounded up to the largest alignment). Fields are read
+// and written by member pointer: r.get<&Order::price>().
+//
+// HotColdArray splits a record type into two PackedRecord arrays: the hot
+// fields a scan reads, packed densely so several records share a cache
+// line, and the cold rest, which a scan never pulls into cache.
+//
+//   hpc::HotColdArray<Order, hpc::FieldList<&Order::price, &Order::qty>,
+//                            hpc::FieldList<&Order::side, &Order::flag>> book(n);
+//   book.hot(i).get<&Order::price>()
+//
+// Layout properties (size, alignment, records per line) are constexpr, so
+// callers can static_assert them.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hpc {
+
+constexpr size_t PACKED_CACHE_LINE = 64;
+
+// Field list for HotColdArray
+template <auto... Members>
+struct FieldList {};
+
+namespace detail {
+
+template <typename MemberPointer>
+struct RecordMember;
+
+template <typename Record, typename Field>
+struct RecordMember<Field Record::*> {
+    using record = Record;
+    using type = Field;
+};
+
+template <auto Field>
+using RecordFieldType = typename RecordMember<decltype(Field)>::type;
+
+// Offsets of N fields placed in order of decreasing alignment (stable, so
+// equally aligned fields keep their declaration order)
+template <size_t N>
+struct PackedLayout {
+    std::array<size_t, N> offsets{};
+    size_t size = 0;
+    size_t alignment = 1;
+    size_t payload = 0;
+};
+
+template <size_t N>
+constexpr PackedLayout<N> packedLayout(const std::array<size_t, N>& sizes,
+                                       const std::array<size_t, N>& alignments) {
+    std::array<size_t, N> order{};
+    for (size_t i = 0; i < N; ++i) {
+        order[i] = i;
+    }
+    for (size_t i = 1; i < N; ++i) {
+        for (size_t j = i; j > 0 && alignments[order[j - 1]] < alignments[order[j]]; --j) {
+            const size_t t = order[j - 1];
+            order[j - 1] = order[j];
+            order[j] = t;
+        }
+    }
+    PackedLayout<N> layout;
+    size_t offset = 0;
+    for (size_t k = 0; k < N; ++k) {
+        const size_t f = order[k];
+        offset = (offset + alignments[f] - 1) / alignments[f] * alignments[f];
+        layout.offsets[f] = offset;
+        offset += sizes[f];
+        layout.payload += sizes[f];
+        layout.alignment = std::max(layout.alignment, alignments[f]);
+    }
+    layout.size = (std::max<size_t>(offset, 1) + layout.alignment - 1) / layout.alignment * layout.alignment;
+    return layout;
+}
+
+} // namespace detail
+
+template <typename Record, auto... Fields>
+class PackedRecord {
+    static_assert(sizeof...(Fields) > 0, "PackedRecord needs at least one field");
+    static_assert((std::is_same_v<typename detail::RecordMember<decltype(Fields)>::record, Record> && ...),
+                  "every field must be a member of Record");
+    static_assert((std::is_trivially_copyable_v<detail::RecordFieldType<Fields>> && ...),
+                  "fields must be trivially copyable");
+
+    static constexpr detail::PackedLayout<sizeof...(Fields)> layout_ = detail::packedLayout<sizeof...(Fields)>(
+        {sizeof(detail::RecordFieldType<Fields>)...}, {alignof(detail::RecordFieldType<Fields>)...});
+
+public:
+    static constexpr size_t field_count = sizeof...(Fields);
+    static constexpr size_t size = layout_.size;
+    static constexpr size_t alignment = layout_.alignment;
+    static constexpr size_t payload_bytes = layout_.payload;
+    static constexpr size_t padding_bytes = size - payload_bytes;
+    // Records per cache line; fractional when size does not divide the
+    // line, and then some records straddle two lines
+    static constexpr double records_per_line = static_cast<double>(PACKED_CACHE_LINE) / size;
+
+    template <auto Key>
+    static constexpr size_t offset() { return layout_.offsets[fieldIndex<Key>()]; }
+
+    PackedRecord() = default;
+    explicit PackedRecord(const Record& record) { store(record); }
+
+    template <auto Key>
+    detail::RecordFieldType<Key>& get() {
+        return *reinterpret_cast<detail::RecordFieldType<Key>*>(bytes_ + offset<Key>());
+    }
+    template <auto Key>
+    const detail::RecordFieldType<Key>& get() const {
+        return *reinterpret_cast<const detail::RecordFieldType<Key>*>(bytes_ + offset<Key>());
+    }
+
+    // Copy the listed fields from / to an ordinary Record; fields of Record
+    // that are not listed are left value-initialized by load()
+    void store(const Record& record) { (void(get<Fields>() = record.*Fields), ...); }
+    void loadInto(Record& record) const { (void(record.*Fields = get<Fields>()), ...); }
+    Record load() const {
+        Record record{};
+        loadInto(record);
+        return record;
+    }
+
+private:
+    template <auto Key, size_t I = 0>
+    static constexpr size_t fieldIndex() {
+        static_assert(I < field_count, "not a field of this PackedRecord");
+        using Candidate = std::tuple_element_t<I, std::tuple<decltype(Fields)...>>;
+        constexpr Candidate candidate = std::get<I>(std::make_tuple(Fields...));
+        if constexpr (std::is_same_v<Candidate, decltype(Key)>) {
+            if constexpr (std::is_same_v<std::integral_constant<Candidate, candidate>,
+                                         std::integral_constant<decltype(Key), Key>>) {
+                return I;
+            } else {
+                return fieldIndex<Key, I + 1>();
+            }
+        } else {
+            return fieldIndex<Key, I + 1>();
+        }
+    }
+
+    alignas(layout_.alignment) unsigned char bytes_[layout_.size] = {};
+};
+
+template <typename Record, typename Hot, typename Cold>
+class HotColdArray;
+
+// Records split into a dense hot array and a cold array, both std::pmr
+// vectors on the default resource (so arena accounting sees them)
+template <typename Record, auto... HotFields, auto... ColdFields>
+class HotColdArray<Record, FieldList<HotFields...>, FieldList<ColdFields...>> {
+public:
+    using HotRecord = PackedRecord<Record, HotFields...>;
+    using ColdRecord = PackedRecord<Record, ColdFields...>;
+
+    static_assert(sizeof(HotRecord) == HotRecord::size && alignof(HotRecord) == HotRecord::alignment,
+                  "hot record layout differs from the computed one");
+    static_assert(sizeof(ColdRecord) == ColdRecord::size && alignof(ColdRecord) == ColdRecord::alignment,
+                  "cold record layout differs from the computed one");
+    static_assert(HotRecord::size <= PACKED_CACHE_LINE, "hot fields must fit in one cache line");
+
+    explicit HotColdArray(size_t n = 0) : hot_(n), cold_(n) {}
+
+    size_t size() const { return hot_.size(); }
+
+    HotRecord& hot(size_t i) { return hot_[i]; }
+    const HotRecord& hot(size_t i) const { return hot_[i]; }
+    ColdRecord& cold(size_t i) { return cold_[i]; }
+    const ColdRecord& cold(size_t i) const { return cold_[i]; }
+
+    const HotRecord* hotData() const { return hot_.data(); }
+    const ColdRecord* coldData() const { return cold_.data(); }
+
+    void store(size_t i, const Record& record) {
+        hot_[i].store(record);
+        cold_[i].store(record);
+    }
+    Record load(size_t i) const {
+        Record record{};
+        hot_[i].loadInto(record);
+        cold_[i].loadInto(record);
+        return record;
+    }
+
+private:
+    std::pmr::vector<HotRecord> hot_;
+    std::pmr::vector<ColdRecord> cold_;
+};
+
+} // namespace hpc
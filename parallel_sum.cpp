@@ -1,54 +1,194 @@
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <chrono>
 #include <fstream>
+#include <numeric>
+#include <string>
+#include "perf_counters.h"
+#include "thread_pool.h"
+#include "benchmark.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 std::mutex mtx;
 // std::atomic<long long> sum;
 long long sum = 0;;
 
-void partial_sum(const std::vector<int> &data, int start, int end)
+void partial_sum(const std::vector<int> &data, size_t start, size_t end)
 {
     long long local_sum = 0;
-    for (int i = start; i < end; ++i)
+    for (size_t i = start; i < end; ++i)
         local_sum += data[i];
     std::lock_guard<std::mutex> lock(mtx);
     sum += local_sum;
 }
 
-int main()
+long long sumRange(const int *data, size_t start, size_t end)
 {
-    const int N = 100000000;
-    std::vector<int> data(N, 1);
-    int num_threads = 4;
-    sum = 0;
-    std::vector<std::thread> threads;
-    int chunk = N / num_threads;
+    long long s = 0;
+    for (size_t i = start; i < end; ++i)
+        s += data[i];
+    return s;
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
-    for (int t = 0; t < num_threads; ++t)
+// The reduction as it was before the pool: a fresh std::thread per chunk,
+// created and joined on every call
+long long threadPerCallSum(const int *data, size_t n, size_t num_threads)
+{
+    std::vector<long long> partial(num_threads, 0);
+    std::vector<std::thread> threads;
+    size_t chunk = n / num_threads;
+    for (size_t t = 0; t < num_threads; ++t)
     {
-        int start = t * chunk;
-        int end = (t == num_threads - 1) ? N : start + chunk;
-        threads.emplace_back(partial_sum, std::ref(data), start, end);
+        size_t start = t * chunk;
+        size_t end = (t == num_threads - 1) ? n : start + chunk;
+        threads.emplace_back([&partial, data, t, start, end] { partial[t] = sumRange(data, start, end); });
     }
     for (auto &th : threads)
         th.join();
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
+    return std::accumulate(partial.begin(), partial.end(), 0LL);
+}
+
+long long poolSum(hpc::ThreadPool &pool, const int *data, size_t n)
+{
+    std::vector<long long> partial(pool.size(), 0);
+    pool.parallelFor(0, n, [&](size_t start, size_t end, size_t worker) {
+        partial[worker] = sumRange(data, start, end);
+    });
+    return std::accumulate(partial.begin(), partial.end(), 0LL);
+}
+
+#ifdef _OPENMP
+long long ompSum(const int *data, size_t n, int num_threads)
+{
+    long long s = 0;
+    #pragma omp parallel for reduction(+:s) num_threads(num_threads) schedule(static)
+    for (size_t i = 0; i < n; ++i)
+        s += data[i];
+    return s;
+}
+#endif
+
+// Median latency of one sum per input size, 1 KB - 1 GB: serial, thread per
+// call, the persistent pool and OpenMP, all with num_threads threads
+void latencySweep(size_t num_threads)
+{
+    std::cout << "\n=== Reduction latency, median μs (" << num_threads << " threads) ===\n";
+    std::cout << std::setw(9) << "size" << std::setw(12) << "serial" << std::setw(16) << "thread/call"
+              << std::setw(12) << "pool" << std::setw(12) << "OpenMP" << std::setw(16) << "pool speedup"
+              << "\n";
+
+    hpc::ThreadPool pool(num_threads);
+    for (size_t bytes = size_t(1) << 10; bytes <= size_t(1) << 30; bytes <<= 4)
+    {
+        const size_t n = bytes / sizeof(int);
+        std::vector<int> data(n, 1);
+        const std::string suffix = ", " + std::to_string(bytes >> 10) + " KB";
+        long long serial_sum = 0, per_call_sum = 0, pool_sum = 0, omp_sum = 0;
+
+        auto us = [&](const std::string &name, auto &&kernel) {
+            return hpc::benchmark(name + suffix, n, kernel).median * 1e6;
+        };
+        const double serial_us = us("serial", [&] { serial_sum = sumRange(data.data(), 0, n); });
+        const double per_call_us = us("thread per call", [&] {
+            per_call_sum = threadPerCallSum(data.data(), n, num_threads);
+        });
+        const double pool_us = us("thread pool", [&] { pool_sum = poolSum(pool, data.data(), n); });
+#ifdef _OPENMP
+        const double omp_us = us("OpenMP", [&] {
+            omp_sum = ompSum(data.data(), n, static_cast<int>(num_threads));
+        });
+#else
+        const double omp_us = 0.0;
+        omp_sum = serial_sum;
+#endif
 
-    std::cout << "Sum: " << sum << std::endl;
-    std::cout << "duration: " << duration.count() << " milli secs\n";
+        std::cout << std::setw(6) << (bytes >= (size_t(1) << 20) ? bytes >> 20 : bytes >> 10)
+                  << (bytes >= (size_t(1) << 20) ? " MB" : " KB") << std::fixed << std::setprecision(2)
+                  << std::setw(12) << serial_us << std::setw(16) << per_call_us << std::setw(12) << pool_us
+                  << std::setw(12) << omp_us << std::setw(15) << per_call_us / pool_us << "x"
+                  << std::defaultfloat << "\n";
+        const long long expected = static_cast<long long>(n);
+        if (serial_sum != expected || per_call_sum != expected || pool_sum != expected || omp_sum != expected)
+            std::cout << "✗ Sums differ at " << bytes << " bytes\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // Mode argument: "sum" runs only the 100M-element sum, "sweep" only the
+    // latency sweep; --json PATH and the other benchmark.h flags also apply
+    hpc::BenchConfig bench_config;
+    try
+    {
+        bench_config = hpc::parseBenchArgs(argc, argv);
+        hpc::configureBench(bench_config);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Benchmark options: " << e.what() << "\n";
+        return 1;
+    }
+    hpc::setBenchSink([](const hpc::BenchStats &stats) { std::cout << "  [bench] " << stats.summary() << "\n"; });
+    std::string mode = "all";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!hpc::isBenchArg(argc, argv, i))
+        {
+            mode = argv[i];
+            break;
+        }
+    }
 
-    std::ofstream log("log.txt", std::ios::app);
+    const int N = 100000000;
+    int num_threads = 4;
+
+    // Opened before the workers start, so they inherit the counters and
+    // their counts are added when they are joined
+    std::cout << "Performance counters: " << hpc::perfCounters().describe() << std::endl;
+
+    if (mode != "sweep")
+    {
+        std::vector<int> data(N, 1);
+        sum = 0;
+        hpc::PerfRegion counters("parallel_sum", N);
+        std::chrono::duration<double, std::milli> duration;
+        {
+            // The pool joins its workers at the end of this scope, before
+            // the region stops; the timing covers only the sum
+            hpc::ThreadPool pool(num_threads);
+            auto start = std::chrono::high_resolution_clock::now();
+            pool.parallelFor(0, N, [&](size_t lo, size_t hi, size_t) { partial_sum(data, lo, hi); });
+            auto end = std::chrono::high_resolution_clock::now();
+            duration = end - start;
+        }
+        counters.stop();
+
+        std::cout << "Sum: " << sum << std::endl;
+        std::cout << "duration: " << duration.count() << " milli secs\n";
+
+        std::ofstream log("log.txt", std::ios::app);
 #ifdef PROJECT_NAME
-    log << "Project name: " << PROJECT_NAME << std::endl;
+        log << "Project name: " << PROJECT_NAME << std::endl;
 #else
-    log << "Project name: (undefined)" << std::endl;
+        log << "Project name: (undefined)" << std::endl;
 #endif
-    log << "Sum: " << sum << std::endl;
-    log << "Duration: " << duration.count() << " milli secs" << "\n\n";
-}
\ No newline at end of file
+        log << "Sum: " << sum << std::endl;
+        log << "Duration: " << duration.count() << " milli secs" << "\n\n";
+    }
+
+    if (mode != "sum")
+        latencySweep(num_threads);
+
+    if (!bench_config.json_path.empty())
+    {
+        hpc::writeBenchJson(bench_config.json_path);
+        std::cout << "Benchmark results written to " << bench_config.json_path << "\n";
+    }
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+// Performance counters around benchmark kernels.
+//
+// perfCounters() opens, once per process, one perf_event_open counter per
+// event for the calling thread:
+//
+//   hardware   cycles, instructions, L1D read misses, LLC misses, dTLB read
+//              misses, branch misses (user space only, which is what
+//              perf_event_paranoid <= 2 allows)
+//   software   task-clock, page faults, context switches
+//
+// Where the PMU is not exposed (most VMs and containers) or perf_event_open
+// is blocked, only the software events are available, and without
+// perf_event_open at all task-clock, page faults and context switches come
+// from getrusage(). The counters run continuously; a region reads them at
+// start and stop and reports the difference, scaled for multiplexing when
+// the PMU had to time-share counters.
+//
+//   {
+//       hpc::PerfRegion counters("naive matmul", n * n * n);
+//       kernel();
+//       counters.stop();   // report to the sink set by setPerfSink();
+//   }                      // without stop(), at the end of the scope
+//
+// Reports carry IPC and events per element (elements = 0: absolute counts).
+//
+// Threads: counters are inherited by threads created after perfCounters()
+// is first called, but an inherited thread's counts are only added when it
+// exits. std::thread workers joined inside a region are therefore included;
+// long-lived OpenMP workers are not, so for OpenMP kernels the counts are
+// the calling thread's share (getrusage in the fallback covers the process).
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace hpc {
+
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    DTLBMisses,
+    BranchMisses,
+    TaskClock,        // nanoseconds of CPU time
+    PageFaults,
+    ContextSwitches,
+    Count
+};
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::Count);
+
+inline const char* perfEventName(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::L1DMisses: return "L1D misses";
+        case PerfEvent::LLCMisses: return "LLC misses";
+        case PerfEvent::DTLBMisses: return "dTLB misses";
+        case PerfEvent::BranchMisses: return "branch misses";
+        case PerfEvent::TaskClock: return "task-clock";
+        case PerfEvent::PageFaults: return "page faults";
+        case PerfEvent::ContextSwitches: return "context switches";
+        case PerfEvent::Count: break;
+    }
+    return "unknown";
+}
+
+// Most detailed source that could be opened
+enum class PerfMode { Hardware, Software, Rusage, None };
+
+struct PerfSample {
+    std::array<double, PERF_EVENT_COUNT> values{};
+    std::array<bool, PERF_EVENT_COUNT> valid{};
+    double seconds = 0.0;   // wall clock
+
+    bool has(PerfEvent event) const { return valid[static_cast<size_t>(event)]; }
+    double operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+
+    PerfSample operator-(const PerfSample& start) const {
+        PerfSample delta;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            delta.valid[i] = valid[i] && start.valid[i];
+            delta.values[i] = delta.valid[i] ? values[i] - start.values[i] : 0.0;
+        }
+        delta.seconds = seconds - start.seconds;
+        return delta;
+    }
+};
+
+struct PerfReport {
+    std::string name;
+    uint64_t elements = 0;
+    PerfSample counts;
+    PerfMode mode = PerfMode::None;
+
+    // Instructions per cycle, 0 without hardware counters
+    double ipc() const {
+        if (!counts.has(PerfEvent::Cycles) || !counts.has(PerfEvent::Instructions) ||
+            counts[PerfEvent::Cycles] <= 0.0) {
+            return 0.0;
+        }
+        return counts[PerfEvent::Instructions] / counts[PerfEvent::Cycles];
+    }
+
+    // Events per element, or the absolute count when elements is 0
+    double perElement(PerfEvent event) const {
+        return elements > 0 ? counts[event] / static_cast<double>(elements) : counts[event];
+    }
+
+    // One line: "name: IPC 2.31, per element: L1D misses 0.0625, ..."
+    std::string summary() const {
+        char buffer[96];
+        std::string line = name + ":";
+        auto append = [&](const char* format, auto... args) {
+            std::snprintf(buffer, sizeof(buffer), format, args...);
+            line += buffer;
+        };
+        bool first = true;
+        auto separator = [&]() -> const char* {
+            const char* s = first ? " " : ", ";
+            first = false;
+            return s;
+        };
+        if (counts.has(PerfEvent::Cycles)) {
+            append("%sIPC %.2f (%.3g cycles)", separator(), ipc(), counts[PerfEvent::Cycles]);
+        }
+        if (counts.has(PerfEvent::TaskClock)) {
+            append("%s%s %.2f ms", separator(), perfEventName(PerfEvent::TaskClock),
+                   counts[PerfEvent::TaskClock] * 1e-6);
+        }
+        line += elements > 0 ? "; per element:" : ";";
+        first = true;
+        for (PerfEvent event : {PerfEvent::L1DMisses, PerfEvent::LLCMisses, PerfEvent::DTLBMisses,
+                                PerfEvent::BranchMisses, PerfEvent::PageFaults, PerfEvent::ContextSwitches}) {
+            if (counts.has(event)) {
+                append("%s%s %.4g", separator(), perfEventName(event), perElement(event));
+            }
+        }
+        return line;
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds_.fill(-1);
+#if defined(__linux__)
+        const uint64_t cache_read_miss = (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+                                         (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+        open(PerfEvent::Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(PerfEvent::Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(PerfEvent::L1DMisses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss);
+        open(PerfEvent::LLCMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(PerfEvent::DTLBMisses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_read_miss);
+        open(PerfEvent::BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(PerfEvent::TaskClock, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        open(PerfEvent::PageFaults, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+        open(PerfEvent::ContextSwitches, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+#endif
+        if (isOpen(PerfEvent::Cycles)) {
+            mode_ = PerfMode::Hardware;
+        } else if (isOpen(PerfEvent::TaskClock)) {
+            mode_ = PerfMode::Software;
+        } else {
+#if defined(__unix__) || defined(__APPLE__)
+            mode_ = PerfMode::Rusage;
+#endif
+        }
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    PerfMode mode() const { return mode_; }
+
+    std::string describe() const {
+        switch (mode_) {
+            case PerfMode::Hardware: return "hardware counters (perf_event_open)";
+            case PerfMode::Software:
+                return "software counters only (perf_event_open; no PMU access, see "
+                       "/proc/sys/kernel/perf_event_paranoid)";
+            case PerfMode::Rusage: return "getrusage only (perf_event_open unavailable)";
+            case PerfMode::None: break;
+        }
+        return "no counters";
+    }
+
+    PerfSample read() const {
+        PerfSample sample;
+        sample.seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#if defined(__linux__)
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (fds_[i] < 0) {
+                continue;
+            }
+            // value, time enabled, time running
+            uint64_t data[3] = {0, 0, 0};
+            if (::read(fds_[i], data, sizeof(data)) == static_cast<ssize_t>(sizeof(data))) {
+                sample.values[i] = data[2] > 0 ? static_cast<double>(data[0]) * data[1] / data[2] : 0.0;
+                sample.valid[i] = true;
+            }
+        }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+        if (mode_ == PerfMode::Rusage) {
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            auto set = [&sample](PerfEvent event, double value) {
+                sample.values[static_cast<size_t>(event)] = value;
+                sample.valid[static_cast<size_t>(event)] = true;
+            };
+            set(PerfEvent::TaskClock, (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e9 +
+                                          (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e3);
+            set(PerfEvent::PageFaults, static_cast<double>(usage.ru_minflt + usage.ru_majflt));
+            set(PerfEvent::ContextSwitches, static_cast<double>(usage.ru_nvcsw + usage.ru_nivcsw));
+        }
+#endif
+        return sample;
+    }
+
+private:
+    bool isOpen(PerfEvent event) const { return fds_[static_cast<size_t>(event)] >= 0; }
+
+#if defined(__linux__)
+    void open(PerfEvent event, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // Kernel-side counts need perf_event_paranoid < 2 for hardware
+        // events; software events (page faults happen in the kernel) are
+        // tried with them first
+        attr.exclude_kernel = type == PERF_TYPE_SOFTWARE ? 0 : 1;
+        attr.exclude_hv = 1;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd < 0 && !attr.exclude_kernel) {
+            attr.exclude_kernel = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        fds_[static_cast<size_t>(event)] = fd;
+    }
+#endif
+
+    std::array<int, PERF_EVENT_COUNT> fds_;
+    PerfMode mode_ = PerfMode::None;
+};
+
+// Process-wide counters; call once early (before worker threads start) so
+// later threads inherit them
+inline PerfCounters& perfCounters() {
+    static PerfCounters counters;
+    return counters;
+}
+
+using PerfSink = std::function<void(const PerfReport&)>;
+
+// Where finished regions are reported; prints "  [counters] ..." to stdout
+// until a program installs its own logger
+inline PerfSink& perfSink() {
+    static PerfSink sink = [](const PerfReport& report) {
+        std::printf("  [counters] %s\n", report.summary().c_str());
+    };
+    return sink;
+}
+
+inline void setPerfSink(PerfSink sink) { perfSink() = std::move(sink); }
+
+class PerfRegion {
+public:
+    explicit PerfRegion(std::string name, uint64_t elements = 0) {
+        report_.name = std::move(name);
+        report_.elements = elements;
+        report_.mode = perfCounters().mode();
+        start_ = perfCounters().read();
+    }
+
+    ~PerfRegion() { stop(); }
+
+    PerfRegion(const PerfRegion&) = delete;
+    PerfRegion& operator=(const PerfRegion&) = delete;
+
+    // For regions whose amount of work is only known at the end
+    void setElements(uint64_t elements) { report_.elements = elements; }
+
+    // Ends the measured interval and hands the report to the sink; later
+    // calls (and the destructor) only return it
+    const PerfReport& stop() {
+        if (!stopped_) {
+            report_.counts = perfCounters().read() - start_;
+            stopped_ = true;
+            if (perfSink()) {
+                perfSink()(report_);
+            }
+        }
+        return report_;
+    }
+
+private:
+    PerfReport report_;
+    PerfSample start_;
+    bool stopped_ = false;
+};
+
+} // namespace hpc
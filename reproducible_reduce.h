@@ -0,0 +1,334 @@
+#pragma once
+
+// Sum and dot product of float arrays whose result is bitwise identical for
+// any OpenMP thread count and any dispatched ISA (simd_kernels.h).
+//
+// A SIMD or parallel reduction adds in an order set by the vector width and
+// the thread count, so the last bits of its result change with both. Here
+// the order is fixed by the data length alone:
+//
+//   - the input is cut into chunks of REPRO_CHUNK elements; the chunks are
+//     spread over the threads, but each one is reduced on its own
+//   - inside a chunk, element i goes to virtual lane i % REPRO_LANES; each
+//     lane accumulates its elements in order, and a group with fewer than
+//     REPRO_LANES elements left is padded with zeros. AVX-512 holds the 64
+//     lanes in 4 registers, AVX2 in 8 and the portable code in an array,
+//     so the per-lane operations are the same whatever the width
+//   - the lanes are combined by a fixed pairwise tree (lane l with l + 32,
+//     then l + 16, ... l + 1), and the chunk results by another (chunk k
+//     with k + 1, then k + 2, k + 4, ...)
+//
+// Products are fused (dot accumulates fma(x, y, s) in every ISA; the
+// portable version calls std::fma, which is a slow library call on hosts
+// without FMA). Multiplies and adds are never left for the compiler to
+// contract, but the header must not be built with -ffast-math (or
+// -fassociative-math), which lets the compiler reorder the sums.
+//
+// ReproMode::Compensated also carries each lane's rounding error (TwoSum,
+// and the exact product error from the fma for dot) through the same trees
+// and adds it back at the end: the result is as accurate as if it had
+// been computed in twice the precision, and just as reproducible.
+//
+//   float s = hpc::reproducibleSum(x, n);
+//   float d = hpc::reproducibleDot(x, y, n, hpc::ReproMode::Compensated);
+//
+// Different lengths, or the same data in a different order, of course
+// still round differently. NaN and inf propagate as in a plain sum.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "simd_kernels.h"
+
+namespace hpc {
+
+// Virtual lanes per chunk; a multiple of every vector width
+constexpr size_t REPRO_LANES = 64;
+// Elements per chunk, the unit of parallel work
+constexpr size_t REPRO_CHUNK = 4096;
+// Inputs at least this long are split over the OpenMP threads
+constexpr size_t REPRO_PARALLEL_MIN = size_t(1) << 16;
+
+enum class ReproMode { Plain, Compensated };
+
+inline const char* reproModeName(ReproMode mode) {
+    return mode == ReproMode::Compensated ? "compensated" : "plain";
+}
+
+namespace detail {
+
+struct ReproLanes {
+    alignas(64) float sum[REPRO_LANES];
+    alignas(64) float comp[REPRO_LANES];
+};
+
+struct ReproPartial {
+    float sum;
+    float comp;
+};
+
+// s + v = t + e exactly (Knuth's branch-free TwoSum); returns e
+inline float reproTwoSum(float s, float v, float& t) {
+    t = s + v;
+    const float z = t - s;
+    return (s - (t - z)) + (v - z);
+}
+
+inline ReproPartial reproCombine(ReproPartial a, ReproPartial b, bool compensated) {
+    if (!compensated) {
+        return {a.sum + b.sum, 0.0f};
+    }
+    float t;
+    const float e = reproTwoSum(a.sum, b.sum, t);
+    return {t, (a.comp + b.comp) + e};
+}
+
+inline ReproPartial reproLaneTree(const ReproLanes& lanes, bool compensated) {
+    ReproPartial p[REPRO_LANES];
+    for (size_t l = 0; l < REPRO_LANES; ++l) {
+        p[l] = {lanes.sum[l], lanes.comp[l]};
+    }
+    for (size_t width = REPRO_LANES / 2; width > 0; width /= 2) {
+        for (size_t l = 0; l < width; ++l) {
+            p[l] = reproCombine(p[l], p[l + width], compensated);
+        }
+    }
+    return p[0];
+}
+
+// Accumulates x[0, n) (Dot: x[i] * y[i]) into the lanes, n <= REPRO_CHUNK
+using ReproChunkKernel = void (*)(const float* x, const float* y, size_t n, ReproLanes& lanes);
+
+// The last n % REPRO_LANES elements, zero-padded to a whole group
+inline void reproPadTail(const float* x, size_t n, float* buffer) {
+    std::memset(buffer, 0, REPRO_LANES * sizeof(float));
+    std::memcpy(buffer, x, n * sizeof(float));
+}
+
+// One lane, portable: the operations every vector version performs
+template <bool Dot, bool Compensated>
+inline void reproStepPortable(float& s, float& c, float x, float y) {
+    if constexpr (!Compensated) {
+        s = Dot ? std::fma(x, y, s) : s + x;
+    } else if constexpr (Dot) {
+        // fma(x, y, 0) rather than x * y, so that s + p cannot be contracted
+        const float p = std::fma(x, y, 0.0f);
+        const float pe = std::fma(x, y, -p);
+        float t;
+        const float e = reproTwoSum(s, p, t);
+        s = t;
+        c = c + (e + pe);
+    } else {
+        float t;
+        const float e = reproTwoSum(s, x, t);
+        s = t;
+        c = c + e;
+    }
+}
+
+template <bool Dot, bool Compensated>
+inline void reproChunkPortable(const float* x, const float* y, size_t n, ReproLanes& lanes) {
+    float* s = lanes.sum;
+    float* c = lanes.comp;
+    size_t i = 0;
+    for (; i + REPRO_LANES <= n; i += REPRO_LANES) {
+        for (size_t l = 0; l < REPRO_LANES; ++l) {
+            reproStepPortable<Dot, Compensated>(s[l], c[l], x[i + l], Dot ? y[i + l] : 0.0f);
+        }
+    }
+    if (i < n) {
+        float xb[REPRO_LANES], yb[REPRO_LANES];
+        reproPadTail(x + i, n - i, xb);
+        reproPadTail(Dot ? y + i : x + i, n - i, yb);
+        for (size_t l = 0; l < REPRO_LANES; ++l) {
+            reproStepPortable<Dot, Compensated>(s[l], c[l], xb[l], yb[l]);
+        }
+    }
+}
+
+#if defined(HPC_SIMD_X86_DISPATCH)
+
+template <bool Dot, bool Compensated>
+__attribute__((target("avx2,fma")))
+inline void reproStepAvx2(__m256& s, __m256& c, __m256 x, __m256 y) {
+    if constexpr (!Compensated) {
+        s = Dot ? _mm256_fmadd_ps(x, y, s) : _mm256_add_ps(s, x);
+        return;
+    }
+    __m256 v = x, ve = _mm256_setzero_ps();
+    if constexpr (Dot) {
+        v = _mm256_fmadd_ps(x, y, _mm256_setzero_ps());
+        ve = _mm256_fmsub_ps(x, y, v);
+    }
+    const __m256 t = _mm256_add_ps(s, v);
+    const __m256 z = _mm256_sub_ps(t, s);
+    const __m256 e = _mm256_add_ps(_mm256_sub_ps(s, _mm256_sub_ps(t, z)), _mm256_sub_ps(v, z));
+    s = t;
+    c = _mm256_add_ps(c, Dot ? _mm256_add_ps(e, ve) : e);
+}
+
+// One group of REPRO_LANES elements, 8 lanes per register
+template <bool Dot, bool Compensated>
+__attribute__((target("avx2,fma")))
+inline void reproGroupAvx2(__m256* s, __m256* c, const float* x, const float* y) {
+    for (size_t v = 0; v < REPRO_LANES / 8; ++v) {
+        reproStepAvx2<Dot, Compensated>(s[v], c[v], _mm256_loadu_ps(x + 8 * v),
+                                        Dot ? _mm256_loadu_ps(y + 8 * v) : _mm256_setzero_ps());
+    }
+}
+
+template <bool Dot, bool Compensated>
+__attribute__((target("avx2,fma")))
+inline void reproChunkAvx2(const float* x, const float* y, size_t n, ReproLanes& lanes) {
+    constexpr size_t VECTORS = REPRO_LANES / 8;
+    __m256 s[VECTORS], c[VECTORS];
+    for (size_t v = 0; v < VECTORS; ++v) {
+        s[v] = _mm256_load_ps(lanes.sum + 8 * v);
+        c[v] = _mm256_load_ps(lanes.comp + 8 * v);
+    }
+    size_t i = 0;
+    for (; i + REPRO_LANES <= n; i += REPRO_LANES) {
+        reproGroupAvx2<Dot, Compensated>(s, c, x + i, Dot ? y + i : x + i);
+    }
+    if (i < n) {
+        float xb[REPRO_LANES], yb[REPRO_LANES];
+        reproPadTail(x + i, n - i, xb);
+        reproPadTail(Dot ? y + i : x + i, n - i, yb);
+        reproGroupAvx2<Dot, Compensated>(s, c, xb, yb);
+    }
+    for (size_t v = 0; v < VECTORS; ++v) {
+        _mm256_store_ps(lanes.sum + 8 * v, s[v]);
+        _mm256_store_ps(lanes.comp + 8 * v, c[v]);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+template <bool Dot, bool Compensated>
+__attribute__((target("avx512f")))
+inline void reproStepAvx512(__m512& s, __m512& c, __m512 x, __m512 y) {
+    if constexpr (!Compensated) {
+        s = Dot ? _mm512_fmadd_ps(x, y, s) : _mm512_add_ps(s, x);
+        return;
+    }
+    __m512 v = x, ve = _mm512_setzero_ps();
+    if constexpr (Dot) {
+        v = _mm512_fmadd_ps(x, y, _mm512_setzero_ps());
+        ve = _mm512_fmsub_ps(x, y, v);
+    }
+    const __m512 t = _mm512_add_ps(s, v);
+    const __m512 z = _mm512_sub_ps(t, s);
+    const __m512 e = _mm512_add_ps(_mm512_sub_ps(s, _mm512_sub_ps(t, z)), _mm512_sub_ps(v, z));
+    s = t;
+    c = _mm512_add_ps(c, Dot ? _mm512_add_ps(e, ve) : e);
+}
+
+template <bool Dot, bool Compensated>
+__attribute__((target("avx512f")))
+inline void reproChunkAvx512(const float* x, const float* y, size_t n, ReproLanes& lanes) {
+    constexpr size_t VECTORS = REPRO_LANES / 16;
+    __m512 s[VECTORS], c[VECTORS];
+    for (size_t v = 0; v < VECTORS; ++v) {
+        s[v] = _mm512_load_ps(lanes.sum + 16 * v);
+        c[v] = _mm512_load_ps(lanes.comp + 16 * v);
+    }
+    size_t i = 0;
+    for (; i < n; i += REPRO_LANES) {
+        // Masked loads zero the lanes past n, as the padding does elsewhere
+        for (size_t v = 0; v < VECTORS; ++v) {
+            const size_t first = i + 16 * v;
+            const __mmask16 m = first >= n ? 0 : tailMask512(std::min<size_t>(n - first, 16));
+            reproStepAvx512<Dot, Compensated>(s[v], c[v], _mm512_maskz_loadu_ps(m, x + first),
+                                              Dot ? _mm512_maskz_loadu_ps(m, y + first) : _mm512_setzero_ps());
+        }
+    }
+    for (size_t v = 0; v < VECTORS; ++v) {
+        _mm512_store_ps(lanes.sum + 16 * v, s[v]);
+        _mm512_store_ps(lanes.comp + 16 * v, c[v]);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // HPC_SIMD_X86_DISPATCH
+
+template <bool Dot, bool Compensated>
+inline ReproChunkKernel reproChunkKernel(SimdIsa isa) {
+#if defined(HPC_SIMD_X86_DISPATCH)
+    if (isa == SimdIsa::AVX512) {
+        return reproChunkAvx512<Dot, Compensated>;
+    }
+    if (isa == SimdIsa::AVX2) {
+        return reproChunkAvx2<Dot, Compensated>;
+    }
+#endif
+    (void)isa;
+    return reproChunkPortable<Dot, Compensated>;
+}
+
+inline ReproChunkKernel reproChunkKernel(SimdIsa isa, bool dot, ReproMode mode) {
+    const bool compensated = mode == ReproMode::Compensated;
+    if (dot) {
+        return compensated ? reproChunkKernel<true, true>(isa) : reproChunkKernel<true, false>(isa);
+    }
+    return compensated ? reproChunkKernel<false, true>(isa) : reproChunkKernel<false, false>(isa);
+}
+
+inline float reproReduce(SimdIsa isa, const float* x, const float* y, size_t n, ReproMode mode) {
+    const ReproChunkKernel kernel = reproChunkKernel(isa, y != nullptr, mode);
+    const bool compensated = mode == ReproMode::Compensated;
+    const size_t chunks = (n + REPRO_CHUNK - 1) / REPRO_CHUNK;
+    std::vector<ReproPartial> partials(chunks);
+
+    #pragma omp parallel for schedule(static) if(n >= REPRO_PARALLEL_MIN)
+    for (size_t k = 0; k < chunks; ++k) {
+        ReproLanes lanes = {};
+        const size_t begin = k * REPRO_CHUNK;
+        kernel(x + begin, y ? y + begin : nullptr, std::min(REPRO_CHUNK, n - begin), lanes);
+        partials[k] = reproLaneTree(lanes, compensated);
+    }
+
+    for (size_t stride = 1; stride < chunks; stride *= 2) {
+        for (size_t k = 0; k + stride < chunks; k += 2 * stride) {
+            partials[k] = reproCombine(partials[k], partials[k + stride], compensated);
+        }
+    }
+    if (chunks == 0) {
+        return 0.0f;
+    }
+    return compensated ? partials[0].sum + partials[0].comp : partials[0].sum;
+}
+
+} // namespace detail
+
+// Sum / dot product with the kernels of isa; the result does not depend
+// on isa. Throws std::invalid_argument if isa is not supported.
+inline float reproducibleSum(SimdIsa isa, const float* x, size_t n, ReproMode mode = ReproMode::Plain) {
+    simdKernels(isa);  // validates isa
+    return detail::reproReduce(isa, x, nullptr, n, mode);
+}
+
+inline float reproducibleDot(SimdIsa isa, const float* x, const float* y, size_t n,
+                             ReproMode mode = ReproMode::Plain) {
+    simdKernels(isa);
+    return detail::reproReduce(isa, x, y, n, mode);
+}
+
+// With the dispatched ISA (simdKernels().isa)
+inline float reproducibleSum(const float* x, size_t n, ReproMode mode = ReproMode::Plain) {
+    return detail::reproReduce(simdKernels().isa, x, nullptr, n, mode);
+}
+
+inline float reproducibleDot(const float* x, const float* y, size_t n, ReproMode mode = ReproMode::Plain) {
+    return detail::reproReduce(simdKernels().isa, x, y, n, mode);
+}
+
+} // namespace hpc
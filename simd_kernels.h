@@ -0,0 +1,496 @@
+#pragma once
+
+// Explicit SIMD kernels with runtime ISA dispatch.
+//
+// The other engines (gemm.h, transpose.h, gather.h) pick their kernels from
+// the compile target, so a -march=native binary faults on an older host and
+// a baseline binary leaves AVX-512 unused on a newer one. Here every ISA's
+// kernels are compiled into the same binary with per-function target
+// attributes and one set is chosen at startup from CPUID.
+//
+// The attributes add to the build's -march rather than replace it, so code
+// using these kernels must be built for a baseline target (CMakeLists.txt
+// builds simd_omp for x86-64-v2). Under -march=native the compiler is free
+// to use the host's newest instructions in the SSE4.2 and scalar sets too,
+// which then neither run on an older host nor measure what they claim to.
+//
+//   Scalar  - portable C++, always available (the compiler may still
+//             vectorize it for the build target)
+//   SSE4.2  - 128-bit, x86-64 baseline of the last decade
+//   AVX2    - 256-bit + FMA (Haswell / Zen and later)
+//   AVX-512 - 512-bit AVX-512F, masked loads/stores for the tails
+//   NEON    - 128-bit, every AArch64 core
+//
+// Kernels:
+//   add       a[i] = b[i] + c[i]
+//   dot       sum of b[i] * c[i], products rounded to float and summed in
+//             double (as the scalar loop does)
+//   hypot     a[i] = sqrt(b[i]^2 + c[i]^2)
+//   copy      dst[i] = src[i]
+//   mulShift  a[i] = b[i] * c[i] + (b[i] >> 2), 32-bit integers
+//
+//   const hpc::SimdKernels& k = hpc::simdKernels();   // best for this host
+//   k.add(b, c, a, n);
+//
+// The dispatched set can be forced, to compare ISAs on one host or to
+// reproduce an older host's results: forceSimdIsa(SimdIsa::SSE42), or the
+// HPC_SIMD_ISA environment variable (scalar, sse4.2, avx2, avx512, neon),
+// read on first use. simdKernels(isa) returns any supported ISA's set
+// directly; asking for one the host or the binary lacks throws
+// std::invalid_argument.
+//
+// Pointers need no particular alignment. Results of dot differ between
+// ISAs in the last bits, since each sums in a different order.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HPC_SIMD_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace hpc {
+
+enum class SimdIsa { Scalar, SSE42, AVX2, AVX512, NEON };
+
+inline const char* simdIsaName(SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Scalar: return "scalar";
+        case SimdIsa::SSE42: return "sse4.2";
+        case SimdIsa::AVX2: return "avx2";
+        case SimdIsa::AVX512: return "avx512";
+        case SimdIsa::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+// Inverse of simdIsaName; false if name is not an ISA
+inline bool parseSimdIsa(const std::string& name, SimdIsa& isa) {
+    for (SimdIsa candidate : {SimdIsa::Scalar, SimdIsa::SSE42, SimdIsa::AVX2, SimdIsa::AVX512, SimdIsa::NEON}) {
+        if (name == simdIsaName(candidate)) {
+            isa = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct SimdKernels {
+    SimdIsa isa;
+    void (*add)(const float* b, const float* c, float* a, size_t n);
+    double (*dot)(const float* b, const float* c, size_t n);
+    void (*hypot)(const float* b, const float* c, float* a, size_t n);
+    void (*copy)(const float* src, float* dst, size_t n);
+    void (*mulShift)(const int32_t* b, const int32_t* c, int32_t* a, size_t n);
+};
+
+namespace detail {
+
+// ---- Scalar ----------------------------------------------------------------
+
+inline void addScalar(const float* b, const float* c, float* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = b[i] + c[i];
+    }
+}
+
+inline double dotScalar(const float* b, const float* c, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += b[i] * c[i];
+    }
+    return sum;
+}
+
+inline void hypotScalar(const float* b, const float* c, float* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = std::sqrt(b[i] * b[i] + c[i] * c[i]);
+    }
+}
+
+inline void copyScalar(const float* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+inline void mulShiftScalar(const int32_t* b, const int32_t* c, int32_t* a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = b[i] * c[i] + (b[i] >> 2);
+    }
+}
+
+#if defined(HPC_SIMD_X86_DISPATCH)
+
+// ---- SSE4.2 ----------------------------------------------------------------
+
+__attribute__((target("sse4.2")))
+inline void addSse42(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(c + i)));
+    }
+    addScalar(b + i, c + i, a + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline double dotSse42(const float* b, const float* c, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(c + i));
+        acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(p));
+        acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(p, p)));
+    }
+    __m128d acc = _mm_add_pd(acc0, acc1);
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    return sum + dotScalar(b + i, c + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline void hypotSse42(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(b + i), y = _mm_loadu_ps(c + i);
+        _mm_storeu_ps(a + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+    }
+    hypotScalar(b + i, c + i, a + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline void copySse42(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 x0 = _mm_loadu_ps(src + i), x1 = _mm_loadu_ps(src + i + 4);
+        _mm_storeu_ps(dst + i, x0);
+        _mm_storeu_ps(dst + i + 4, x1);
+    }
+    copyScalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("sse4.2")))
+inline void mulShiftSse42(const int32_t* b, const int32_t* c, int32_t* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i));
+        __m128i r = _mm_add_epi32(_mm_mullo_epi32(x, y), _mm_srai_epi32(x, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), r);
+    }
+    mulShiftScalar(b + i, c + i, a + i, n - i);
+}
+
+// ---- AVX2 ------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+inline void addAvx2(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 s0 = _mm256_add_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i));
+        __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(b + i + 8), _mm256_loadu_ps(c + i + 8));
+        _mm256_storeu_ps(a + i, s0);
+        _mm256_storeu_ps(a + i + 8, s1);
+    }
+    addScalar(b + i, c + i, a + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline double dotAvx2(const float* b, const float* c, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 p0 = _mm256_mul_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(c + i));
+        __m256 p1 = _mm256_mul_ps(_mm256_loadu_ps(b + i + 8), _mm256_loadu_ps(c + i + 8));
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(p0)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(p0, 1)));
+        acc2 = _mm256_add_pd(acc2, _mm256_cvtps_pd(_mm256_castps256_ps128(p1)));
+        acc3 = _mm256_add_pd(acc3, _mm256_cvtps_pd(_mm256_extractf128_ps(p1, 1)));
+    }
+    __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    return sum + dotScalar(b + i, c + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline void hypotAvx2(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(b + i), y = _mm256_loadu_ps(c + i);
+        _mm256_storeu_ps(a + i, _mm256_sqrt_ps(_mm256_fmadd_ps(x, x, _mm256_mul_ps(y, y))));
+    }
+    hypotScalar(b + i, c + i, a + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline void copyAvx2(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 x0 = _mm256_loadu_ps(src + i), x1 = _mm256_loadu_ps(src + i + 8);
+        _mm256_storeu_ps(dst + i, x0);
+        _mm256_storeu_ps(dst + i + 8, x1);
+    }
+    copyScalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline void mulShiftAvx2(const int32_t* b, const int32_t* c, int32_t* a, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + i));
+        __m256i r = _mm256_add_epi32(_mm256_mullo_epi32(x, y), _mm256_srai_epi32(x, 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), r);
+    }
+    mulShiftScalar(b + i, c + i, a + i, n - i);
+}
+
+// ---- AVX-512 ---------------------------------------------------------------
+
+// GCC 12's AVX-512 intrinsics fill unused operands from a self-initialized
+// _mm512_undefined_*(), which -Wall reports as uninitialized once they are
+// inlined into a target("avx512f") function in a -march=native build
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// The first remaining lanes (1-16) of a 16-lane block
+__attribute__((target("avx512f")))
+inline __mmask16 tailMask512(size_t remaining) {
+    return static_cast<__mmask16>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f")))
+inline void addAvx512(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(a + i, _mm512_add_ps(_mm512_loadu_ps(b + i), _mm512_loadu_ps(c + i)));
+    }
+    if (i < n) {
+        const __mmask16 m = tailMask512(n - i);
+        _mm512_mask_storeu_ps(a + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, b + i),
+                                                      _mm512_maskz_loadu_ps(m, c + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline double dotAvx512(const float* b, const float* c, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    // Masked loads cost the same as full ones, so the tail needs no branch
+    for (size_t i = 0; i < n; i += 16) {
+        const __mmask16 m = tailMask512(std::min<size_t>(n - i, 16));
+        __m512 p = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, b + i), _mm512_maskz_loadu_ps(m, c + i));
+        acc0 = _mm512_add_pd(acc0, _mm512_cvtps_pd(_mm512_castps512_ps256(p)));
+        acc1 = _mm512_add_pd(acc1, _mm512_cvtps_pd(
+            _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(p), 1))));
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+inline void hypotAvx512(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(b + i), y = _mm512_loadu_ps(c + i);
+        _mm512_storeu_ps(a + i, _mm512_sqrt_ps(_mm512_fmadd_ps(x, x, _mm512_mul_ps(y, y))));
+    }
+    if (i < n) {
+        const __mmask16 m = tailMask512(n - i);
+        __m512 x = _mm512_maskz_loadu_ps(m, b + i), y = _mm512_maskz_loadu_ps(m, c + i);
+        _mm512_mask_storeu_ps(a + i, m, _mm512_sqrt_ps(_mm512_fmadd_ps(x, x, _mm512_mul_ps(y, y))));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void copyAvx512(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 x0 = _mm512_loadu_ps(src + i), x1 = _mm512_loadu_ps(src + i + 16);
+        _mm512_storeu_ps(dst + i, x0);
+        _mm512_storeu_ps(dst + i + 16, x1);
+    }
+    for (; i < n; i += 16) {
+        const __mmask16 m = tailMask512(std::min<size_t>(n - i, 16));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_maskz_loadu_ps(m, src + i));
+    }
+}
+
+__attribute__((target("avx512f")))
+inline void mulShiftAvx512(const int32_t* b, const int32_t* c, int32_t* a, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512(b + i), y = _mm512_loadu_si512(c + i);
+        _mm512_storeu_si512(a + i, _mm512_add_epi32(_mm512_mullo_epi32(x, y), _mm512_srai_epi32(x, 2)));
+    }
+    if (i < n) {
+        const __mmask16 m = tailMask512(n - i);
+        __m512i x = _mm512_maskz_loadu_epi32(m, b + i), y = _mm512_maskz_loadu_epi32(m, c + i);
+        _mm512_mask_storeu_epi32(a + i, m, _mm512_add_epi32(_mm512_mullo_epi32(x, y), _mm512_srai_epi32(x, 2)));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // HPC_SIMD_X86_DISPATCH
+
+#if defined(__aarch64__)
+
+// ---- NEON ------------------------------------------------------------------
+
+inline void addNeon(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(a + i, vaddq_f32(vld1q_f32(b + i), vld1q_f32(c + i)));
+    }
+    addScalar(b + i, c + i, a + i, n - i);
+}
+
+inline double dotNeon(const float* b, const float* c, size_t n) {
+    float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t p = vmulq_f32(vld1q_f32(b + i), vld1q_f32(c + i));
+        acc0 = vaddq_f64(acc0, vcvt_f64_f32(vget_low_f32(p)));
+        acc1 = vaddq_f64(acc1, vcvt_high_f64_f32(p));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + dotScalar(b + i, c + i, n - i);
+}
+
+inline void hypotNeon(const float* b, const float* c, float* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(b + i), y = vld1q_f32(c + i);
+        vst1q_f32(a + i, vsqrtq_f32(vfmaq_f32(vmulq_f32(y, y), x, x)));
+    }
+    hypotScalar(b + i, c + i, a + i, n - i);
+}
+
+inline void copyNeon(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t x0 = vld1q_f32(src + i), x1 = vld1q_f32(src + i + 4);
+        vst1q_f32(dst + i, x0);
+        vst1q_f32(dst + i + 4, x1);
+    }
+    copyScalar(src + i, dst + i, n - i);
+}
+
+inline void mulShiftNeon(const int32_t* b, const int32_t* c, int32_t* a, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t x = vld1q_s32(b + i), y = vld1q_s32(c + i);
+        vst1q_s32(a + i, vaddq_s32(vmulq_s32(x, y), vshrq_n_s32(x, 2)));
+    }
+    mulShiftScalar(b + i, c + i, a + i, n - i);
+}
+
+#endif // __aarch64__
+
+inline const SimdKernels* simdKernelTable(SimdIsa isa) {
+    static const SimdKernels scalar{SimdIsa::Scalar, addScalar, dotScalar, hypotScalar, copyScalar, mulShiftScalar};
+    switch (isa) {
+        case SimdIsa::Scalar: return &scalar;
+#if defined(HPC_SIMD_X86_DISPATCH)
+        case SimdIsa::SSE42: {
+            static const SimdKernels sse42{SimdIsa::SSE42, addSse42, dotSse42, hypotSse42, copySse42, mulShiftSse42};
+            return &sse42;
+        }
+        case SimdIsa::AVX2: {
+            static const SimdKernels avx2{SimdIsa::AVX2, addAvx2, dotAvx2, hypotAvx2, copyAvx2, mulShiftAvx2};
+            return &avx2;
+        }
+        case SimdIsa::AVX512: {
+            static const SimdKernels avx512{SimdIsa::AVX512, addAvx512, dotAvx512, hypotAvx512, copyAvx512,
+                                            mulShiftAvx512};
+            return &avx512;
+        }
+#endif
+#if defined(__aarch64__)
+        case SimdIsa::NEON: {
+            static const SimdKernels neon{SimdIsa::NEON, addNeon, dotNeon, hypotNeon, copyNeon, mulShiftNeon};
+            return &neon;
+        }
+#endif
+        default: return nullptr;
+    }
+}
+
+} // namespace detail
+
+// True if this binary has kernels for isa and the host CPU (and OS, for
+// the AVX register state) can run them
+inline bool simdIsaSupported(SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Scalar: return true;
+#if defined(HPC_SIMD_X86_DISPATCH)
+        case SimdIsa::SSE42: return __builtin_cpu_supports("sse4.2");
+        case SimdIsa::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case SimdIsa::AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(__aarch64__)
+        case SimdIsa::NEON: return true;
+#endif
+        default: return false;
+    }
+}
+
+// Widest supported ISA
+inline SimdIsa detectSimdIsa() {
+    for (SimdIsa isa : {SimdIsa::AVX512, SimdIsa::AVX2, SimdIsa::NEON, SimdIsa::SSE42}) {
+        if (simdIsaSupported(isa)) {
+            return isa;
+        }
+    }
+    return SimdIsa::Scalar;
+}
+
+// Kernels for a specific ISA, for comparisons
+inline const SimdKernels& simdKernels(SimdIsa isa) {
+    if (!simdIsaSupported(isa)) {
+        throw std::invalid_argument(std::string("SIMD ISA not supported on this host: ") + simdIsaName(isa));
+    }
+    return *detail::simdKernelTable(isa);
+}
+
+namespace detail {
+
+inline const SimdKernels*& dispatchedSimdKernels() {
+    static const SimdKernels* kernels = [] {
+        SimdIsa isa = detectSimdIsa();
+        if (const char* forced = std::getenv("HPC_SIMD_ISA")) {
+            if (!parseSimdIsa(forced, isa)) {
+                throw std::invalid_argument(std::string("HPC_SIMD_ISA: unknown ISA ") + forced);
+            }
+        }
+        return &simdKernels(isa);
+    }();
+    return kernels;
+}
+
+} // namespace detail
+
+// The dispatched kernels: HPC_SIMD_ISA if set, else the widest supported
+inline const SimdKernels& simdKernels() {
+    return *detail::dispatchedSimdKernels();
+}
+
+// Replace the dispatched set; throws std::invalid_argument if unsupported
+inline void forceSimdIsa(SimdIsa isa) {
+    detail::dispatchedSimdKernels() = &simdKernels(isa);
+}
+
+} // namespace hpc
@@ -5,7 +5,21 @@
 #include <random>
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <string>
+#include <set>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
 #include <spdlog/spdlog.h>
+#include "perf_counters.h"
+#include "simd_kernels.h"
+#include "simd_math.h"
+#include "lazy_vector.h"
+#include "reproducible_reduce.h"
+#include "bulk_memory.h"
+#include "cache_topology.h"
+#include "benchmark.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -14,12 +28,60 @@
 int omp_get_max_threads() { return 1; }
 #endif
 
+// Element types of the precision sweep: the printed name and the type dot
+// products accumulate in. Integer sums are unsigned so they wrap instead of
+// overflowing; cast back to signed they equal the true sum whenever it fits.
+template <typename T> struct SweepType;
+template <> struct SweepType<double> { using Acc = double; static constexpr const char* name = "fp64"; };
+template <> struct SweepType<float> { using Acc = double; static constexpr const char* name = "fp32"; };
+template <> struct SweepType<int32_t> { using Acc = uint64_t; static constexpr const char* name = "int32"; };
+template <> struct SweepType<int16_t> { using Acc = uint32_t; static constexpr const char* name = "int16"; };
+template <> struct SweepType<int8_t> { using Acc = uint32_t; static constexpr const char* name = "int8"; };
+
 class SIMDDemo {
 private:
     const size_t N = 1000000;
     std::vector<float> a, b, c;
     std::vector<int> int_a, int_b, int_c;
     
+    // Median time of one call of kernel in μs (benchmark.h); elements is
+    // its work, for the counters
+    template <typename Kernel>
+    static double medianUs(const std::string& name, uint64_t elements, Kernel&& kernel) {
+        return hpc::benchmark(name, elements, kernel).median * 1e6;
+    }
+    
+    // a = b + c over n elements of any sweep type
+    template <typename T>
+    static void simdAdd(const T* b, const T* c, T* a, size_t n) {
+        #ifdef _OPENMP
+        #pragma omp simd
+        #endif
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = static_cast<T>(b[i] + c[i]);
+        }
+    }
+    
+    // Σ b[i] * c[i] over n elements, in SweepType<T>::Acc
+    template <typename T>
+    static typename SweepType<T>::Acc simdDot(const T* b, const T* c, size_t n) {
+        using Acc = typename SweepType<T>::Acc;
+        Acc s = 0;
+        #ifdef _OPENMP
+        #pragma omp simd reduction(+:s)
+        #endif
+        for (size_t i = 0; i < n; ++i) {
+            s += static_cast<Acc>(b[i]) * static_cast<Acc>(c[i]);
+        }
+        return s;
+    }
+    
+    // Elements per second of the sweep's add and dot for one type and size
+    struct SweepRates {
+        double add;
+        double dot;
+    };
+    
 public:
     SIMDDemo() : a(N), b(N), c(N), int_a(N), int_b(N), int_c(N) {
         generateRandomFloat();
@@ -48,193 +110,570 @@ public:
     
     // 1. Basic scalar version (no vectorization)
     double scalarAddition() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = b[i] + c[i];
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Scalar Addition", N, [&] {
+            for (size_t i = 0; i < N; ++i) {
+                a[i] = b[i] + c[i];
+            }
+        });
         
-        spdlog::info("Scalar Addition: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("Scalar Addition: {:.1f} μs", us);
+        return us;
     }
     
     // 2. OpenMP SIMD version (compiler auto-vectorization)
     double autoVectorizedAddition() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        // Compiler should auto-vectorize this with -O3 -march=native
-        #pragma GCC ivdep  // Tell compiler loop has no dependencies
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = b[i] + c[i];
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Auto-Vectorized Addition", N, [&] {
+            // Compiler should auto-vectorize this with -O3 for the build target
+            #pragma GCC ivdep  // Tell compiler loop has no dependencies
+            for (size_t i = 0; i < N; ++i) {
+                a[i] = b[i] + c[i];
+            }
+        });
         
-        spdlog::info("Auto-Vectorized Addition: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("Auto-Vectorized Addition: {:.1f} μs", us);
+        return us;
     }
     
     // 3. OpenMP SIMD version
     double ompSIMDAddition() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        #ifdef _OPENMP
-        #pragma omp simd
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = b[i] + c[i];
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("OpenMP SIMD Addition", N, [&] {
+            simdAdd(b.data(), c.data(), a.data(), N);
+        });
         
-        spdlog::info("OpenMP SIMD Addition: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("OpenMP SIMD Addition: {:.1f} μs", us);
+        return us;
     }
     
     // 4. Complex operation: Dot product (scalar)
     double scalarDotProduct() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
         double sum = 0.0;
-        for (size_t i = 0; i < N; ++i) {
-            sum += b[i] * c[i];
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Scalar Dot Product", N, [&] {
+            double s = 0.0;
+            for (size_t i = 0; i < N; ++i) {
+                s += b[i] * c[i];
+            }
+            sum = s;
+        });
         
-        spdlog::info("Scalar Dot Product: {} μs, Result: {:.2f}", duration.count(), sum);
-        return duration.count();
+        spdlog::info("Scalar Dot Product: {:.1f} μs, Result: {:.2f}", us, sum);
+        return us;
     }
     
     // 5. SIMD Dot product with reduction
     double simdDotProduct() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
         double sum = 0.0;
-        #ifdef _OPENMP
-        #pragma omp simd reduction(+:sum)
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            sum += b[i] * c[i];
-        }
+        const double us = medianUs("SIMD Dot Product", N, [&] {
+            sum = simdDot(b.data(), c.data(), N);
+        });
         
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        
-        spdlog::info("SIMD Dot Product: {} μs, Result: {:.2f}", duration.count(), sum);
-        return duration.count();
+        spdlog::info("SIMD Dot Product: {:.1f} μs, Result: {:.2f}", us, sum);
+        return us;
     }
     
     // 6. Parallel + SIMD combination
     double parallelSIMDAddition() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        #ifdef _OPENMP
-        #pragma omp parallel for simd
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = b[i] + c[i];
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Parallel + SIMD Addition", N, [&] {
+            #ifdef _OPENMP
+            #pragma omp parallel for simd
+            #endif
+            for (size_t i = 0; i < N; ++i) {
+                a[i] = b[i] + c[i];
+            }
+        });
         
-        spdlog::info("Parallel + SIMD Addition: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("Parallel + SIMD Addition: {:.1f} μs", us);
+        return us;
     }
     
     // 7. SIMD with different data types (int operations)
     double simdIntegerOperations() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        #ifdef _OPENMP
-        #pragma omp simd
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            int_a[i] = int_b[i] * int_c[i] + (int_b[i] >> 2);  // Multiply + bit shift
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("SIMD Integer Operations", N, [&] {
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) {
+                int_a[i] = int_b[i] * int_c[i] + (int_b[i] >> 2);  // Multiply + bit shift
+            }
+        });
         
-        spdlog::info("SIMD Integer Operations: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("SIMD Integer Operations: {:.1f} μs", us);
+        return us;
     }
     
     // 8. Math-intensive SIMD operations
     double mathIntensiveOperations() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        #ifdef _OPENMP
-        #pragma omp simd
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = std::sqrt(b[i] * b[i] + c[i] * c[i]);  // Vector magnitude
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Math-Intensive SIMD", N, [&] {
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) {
+                a[i] = std::sqrt(b[i] * b[i] + c[i] * c[i]);  // Vector magnitude
+            }
+        });
         
-        spdlog::info("Math-Intensive SIMD: {} μs", duration.count());
-        return duration.count();
+        spdlog::info("Math-Intensive SIMD: {:.1f} μs", us);
+        return us;
     }
     
     // 9. Memory bandwidth test
     double memoryBandwidthTest() {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        // Simple memory copy operation
-        #ifdef _OPENMP
-        #pragma omp simd
-        #endif
-        for (size_t i = 0; i < N; ++i) {
-            a[i] = b[i];  // Memory bandwidth limited
-        }
-        
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const double us = medianUs("Memory Bandwidth Test", N, [&] {
+            // Simple memory copy operation
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) {
+                a[i] = b[i];  // Memory bandwidth limited
+            }
+        });
         
-        spdlog::info("Memory Bandwidth Test: {} μs", duration.count());
+        spdlog::info("Memory Bandwidth Test: {:.1f} μs", us);
         
-        // Calculate bandwidth
+        // Calculate bandwidth; a and b fit in the LLC, so this is cache
+        // bandwidth (bulkMemorySweep goes beyond it)
         double bytes_transferred = N * sizeof(float) * 2; // Read b, write a
-        double bandwidth_gb_s = bytes_transferred / (duration.count() * 1e-6) / 1e9;
+        double bandwidth_gb_s = bytes_transferred / (us * 1e-6) / 1e9;
         spdlog::info("Memory Bandwidth: {:.2f} GB/s", bandwidth_gb_s);
         
-        return duration.count();
+        return us;
     }
     
     // 10. Loop unrolling demonstration
     double unrolledLoopAddition() {
-        auto start = std::chrono::high_resolution_clock::now();
+        const double us = medianUs("Unrolled Loop Addition", N, [&] {
+            size_t unroll_factor = 4;
+            size_t unrolled_size = N - (N % unroll_factor);
+            
+            // Manually unrolled loop
+            for (size_t i = 0; i < unrolled_size; i += unroll_factor) {
+                a[i] = b[i] + c[i];
+                a[i+1] = b[i+1] + c[i+1];
+                a[i+2] = b[i+2] + c[i+2];
+                a[i+3] = b[i+3] + c[i+3];
+            }
+            
+            // Handle remaining elements
+            for (size_t i = unrolled_size; i < N; ++i) {
+                a[i] = b[i] + c[i];
+            }
+        });
+        
+        spdlog::info("Unrolled Loop Addition: {:.1f} μs", us);
+        return us;
+    }
+    
+    // 11. Explicit SIMD kernels (simd_kernels.h) for every ISA this host
+    //     runs, checked against the scalar versions
+    void dispatchedKernels() {
+        spdlog::info("\n=== Runtime-Dispatched SIMD Kernels (median μs) ===");
+        spdlog::info("{:<8} {:>8} {:>8} {:>8} {:>8} {:>9} {:>10}", "ISA", "add", "dot", "hypot", "copy",
+                    "mulShift", "vs scalar");
+        
+        const hpc::SimdKernels& scalar = hpc::simdKernels(hpc::SimdIsa::Scalar);
+        std::vector<float> expected_add(N), expected_hypot(N);
+        std::vector<int> expected_int(N);
+        scalar.add(b.data(), c.data(), expected_add.data(), N);
+        scalar.hypot(b.data(), c.data(), expected_hypot.data(), N);
+        scalar.mulShift(int_b.data(), int_c.data(), expected_int.data(), N);
+        const double expected_dot = scalar.dot(b.data(), c.data(), N);
+        
+        std::vector<double> scalar_us;
+        for (auto isa : {hpc::SimdIsa::Scalar, hpc::SimdIsa::SSE42, hpc::SimdIsa::AVX2,
+                         hpc::SimdIsa::AVX512, hpc::SimdIsa::NEON}) {
+            if (!hpc::simdIsaSupported(isa)) {
+                continue;
+            }
+            const hpc::SimdKernels& k = hpc::simdKernels(isa);
+            const std::string suffix = std::string(", ") + hpc::simdIsaName(isa);
+            
+            double dot = 0.0;
+            std::vector<double> us = {
+                medianUs("add" + suffix, N, [&] { k.add(b.data(), c.data(), a.data(), N); }),
+                medianUs("dot" + suffix, N, [&] { dot = k.dot(b.data(), c.data(), N); }),
+                medianUs("hypot" + suffix, N, [&] { k.hypot(b.data(), c.data(), a.data(), N); }),
+                medianUs("copy" + suffix, N, [&] { k.copy(b.data(), a.data(), N); }),
+                medianUs("mulShift" + suffix, N, [&] { k.mulShift(int_b.data(), int_c.data(), int_a.data(), N); }),
+            };
+            
+            // a holds the copy and int_a the mulShift result; add and hypot
+            // are rerun to be checked
+            bool match = std::abs(dot - expected_dot) <= 1e-9 * std::abs(expected_dot) &&
+                         std::equal(a.begin(), a.end(), b.begin()) &&
+                         std::equal(int_a.begin(), int_a.end(), expected_int.begin());
+            k.add(b.data(), c.data(), a.data(), N);
+            match = match && std::equal(a.begin(), a.end(), expected_add.begin());
+            k.hypot(b.data(), c.data(), a.data(), N);
+            for (size_t i = 0; i < N && match; ++i) {
+                match = std::abs(a[i] - expected_hypot[i]) <= 1e-6f * expected_hypot[i];
+            }
+            
+            if (scalar_us.empty()) {
+                scalar_us = us;
+            }
+            // Geometric mean of the per-kernel speedups
+            double log_speedup = 0.0;
+            for (size_t j = 0; j < us.size(); ++j) {
+                log_speedup += std::log(scalar_us[j] / us[j]);
+            }
+            spdlog::info("{:<8} {:>8.0f} {:>8.0f} {:>8.0f} {:>8.0f} {:>9.0f} {:>9.2f}x{}", hpc::simdIsaName(isa),
+                        us[0], us[1], us[2], us[3], us[4], std::exp(log_speedup / us.size()),
+                        match ? "" : "  (results differ from scalar)");
+        }
+    }
+    
+    // 12. Vector math (simd_math.h) against libm: time and the largest
+    //     error on this data, in units in the last place
+    void fastMathComparison() {
+        const hpc::SimdIsa isa = hpc::simdKernels().isa;
+        spdlog::info("\n=== Vector Math vs libm ({} kernels, median times) ===",
+                    hpc::simdIsaName(hpc::simdMath().isa));
+        spdlog::info("{:<6} {:>10} {:>10} {:>9} {:>12} {:>9} {:>9}", "", "libm μs", "fast μs", "fast ULP",
+                    "accurate μs", "acc. ULP", "speedup");
+        
+        // exp over [-40, 40], the rest over b and c (0-100)
+        std::vector<float> exp_in(N);
+        for (size_t i = 0; i < N; ++i) {
+            exp_in[i] = 0.8f * b[i] - 40.0f;
+        }
+        
+        auto ulpError = [](float value, double exact) {
+            if (!std::isfinite(exact)) {
+                return value == exact ? 0.0 : INFINITY;
+            }
+            // ilogb(0) is FP_ILOGB0; at zero the spacing is the smallest subnormal
+            const int exponent = exact == 0.0 ? -149 : std::max(std::ilogb(exact) - 23, -149);
+            return std::abs(value - exact) / std::ldexp(1.0, exponent);
+        };
+        auto run = [&](const char* name, auto&& libm, auto&& kernel, auto&& exact) {
+            const double libm_us = medianUs(std::string(name) + ", libm", N, [&] { libm(); });
+            double us[2], ulp[2];
+            for (auto accuracy : {hpc::MathAccuracy::Fast, hpc::MathAccuracy::Accurate}) {
+                const hpc::SimdMathKernels& m = hpc::simdMath(isa, accuracy);
+                const int v = accuracy == hpc::MathAccuracy::Accurate;
+                us[v] = medianUs(std::string(name) + (v ? ", accurate" : ", fast"), N, [&] { kernel(m); });
+                ulp[v] = 0.0;
+                for (size_t i = 0; i < N; ++i) {
+                    ulp[v] = std::max(ulp[v], ulpError(a[i], exact(i)));
+                }
+            }
+            spdlog::info("{:<6} {:>10.0f} {:>10.0f} {:>9.2f} {:>12.0f} {:>9.2f} {:>8.2f}x", name, libm_us,
+                        us[0], ulp[0], us[1], ulp[1], libm_us / us[1]);
+        };
+        
+        run("sqrt", [&] { for (size_t i = 0; i < N; ++i) a[i] = std::sqrt(b[i]); },
+            [&](const hpc::SimdMathKernels& m) { m.sqrt(b.data(), a.data(), N); },
+            [&](size_t i) { return std::sqrt(static_cast<double>(b[i])); });
+        run("rsqrt", [&] { for (size_t i = 0; i < N; ++i) a[i] = 1.0f / std::sqrt(b[i]); },
+            [&](const hpc::SimdMathKernels& m) { m.rsqrt(b.data(), a.data(), N); },
+            [&](size_t i) { return 1.0 / std::sqrt(static_cast<double>(b[i])); });
+        run("exp", [&] { for (size_t i = 0; i < N; ++i) a[i] = std::exp(exp_in[i]); },
+            [&](const hpc::SimdMathKernels& m) { m.exp(exp_in.data(), a.data(), N); },
+            [&](size_t i) { return std::exp(static_cast<double>(exp_in[i])); });
+        run("log", [&] { for (size_t i = 0; i < N; ++i) a[i] = std::log(b[i]); },
+            [&](const hpc::SimdMathKernels& m) { m.log(b.data(), a.data(), N); },
+            [&](size_t i) { return std::log(static_cast<double>(b[i])); });
+        run("hypot", [&] { for (size_t i = 0; i < N; ++i) a[i] = std::hypot(b[i], c[i]); },
+            [&](const hpc::SimdMathKernels& m) { m.hypot(b.data(), c.data(), a.data(), N); },
+            [&](size_t i) { return std::hypot(static_cast<double>(b[i]), static_cast<double>(c[i])); });
+    }
+    
+    // 13. Expression templates (lazy_vector.h): chained vector operations
+    //     fused into one pass, against one pass per operation through
+    //     temporaries
+    void lazyExpressions() {
+        spdlog::info("\n=== Fused Vector Expressions (median times) ===");
+        spdlog::info("{:<26} {:>9} {:>9} {:>8} {:>12} {:>10}", "", "eager μs", "fused μs", "speedup",
+                    "eager bytes", "max diff");
+        std::vector<float> t1(N), t2(N), fused(N);
+        const hpc::SimdMathKernels& m = hpc::simdMath();
+        auto B = hpc::lazy(b), C = hpc::lazy(c);
+        
+        // One pass per operator, as an eager vector library would run it
+        auto mul = [&](const std::vector<float>& x, const std::vector<float>& y, std::vector<float>& out) {
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) out[i] = x[i] * y[i];
+        };
+        auto add = [&](const std::vector<float>& x, const std::vector<float>& y, std::vector<float>& out) {
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) out[i] = x[i] + y[i];
+        };
+        auto scale = [&](const std::vector<float>& x, float s, std::vector<float>& out) {
+            #ifdef _OPENMP
+            #pragma omp simd
+            #endif
+            for (size_t i = 0; i < N; ++i) out[i] = x[i] * s;
+        };
+        auto total = [&](const std::vector<float>& x) {
+            float sum = 0.0f;
+            #ifdef _OPENMP
+            #pragma omp simd reduction(+:sum)
+            #endif
+            for (size_t i = 0; i < N; ++i) sum += x[i];
+            return sum;
+        };
+        
+        // eager_arrays: arrays read or written per element by the eager version
+        auto report = [&](const char* name, double eager_us, double fused_us, int eager_arrays, double diff) {
+            spdlog::info("{:<26} {:>9.0f} {:>9.0f} {:>7.2f}x {:>10.1f}MB {:>10.2e}", name, eager_us, fused_us,
+                        eager_us / fused_us, eager_arrays * N * sizeof(float) / 1e6, diff);
+        };
+        auto maxDiff = [&](const std::vector<float>& x, const std::vector<float>& y) {
+            double diff = 0.0;
+            for (size_t i = 0; i < N; ++i) diff = std::max(diff, static_cast<double>(std::abs(x[i] - y[i])));
+            return diff;
+        };
+        
+        // a = b * c + b - c * 0.5: 4 passes, 11 arrays of traffic; fused: 3
+        double eager = medianUs("b*c + b - c*0.5, eager", N, [&] {
+            mul(b, c, t1); add(t1, b, t1); scale(c, -0.5f, t2); add(t1, t2, a);
+        });
+        double lazy = medianUs("b*c + b - c*0.5, fused", N, [&] { hpc::assign(fused, B * C + B - C * 0.5f); });
+        report("b*c + b - c*0.5", eager, lazy, 11, maxDiff(a, fused));
+        
+        // a = sqrt(b*b + c*c): 4 passes, 10 arrays; fused: 3
+        eager = medianUs("sqrt(b*b + c*c), eager", N, [&] {
+            mul(b, b, t1); mul(c, c, t2); add(t1, t2, t1); m.sqrt(t1.data(), a.data(), N);
+        });
+        lazy = medianUs("sqrt(b*b + c*c), fused", N, [&] { hpc::assign(fused, sqrt(B * B + C * C)); });
+        report("sqrt(b*b + c*c)", eager, lazy, 10, maxDiff(a, fused));
+        
+        // sum(sqrt(b*b + c*c)): the eager version adds a pass over a; fused: 2
+        float eager_sum = 0.0f, lazy_sum = 0.0f;
+        eager = medianUs("sum(sqrt(b*b + c*c)), eager", N, [&] {
+            mul(b, b, t1); mul(c, c, t2); add(t1, t2, t1); m.sqrt(t1.data(), t1.data(), N);
+            eager_sum = total(t1);
+        });
+        lazy = medianUs("sum(sqrt(b*b + c*c)), fused", N, [&] { lazy_sum = hpc::sum(sqrt(B * B + C * C)); });
+        report("sum(sqrt(b*b + c*c))", eager, lazy, 11, std::abs(eager_sum - lazy_sum) / std::abs(lazy_sum));
+        
+        // dot(b, c): product array then sum, 4 arrays; fused: 2
+        float eager_dot = 0.0f, lazy_dot = 0.0f;
+        eager = medianUs("dot(b, c), eager", N, [&] { mul(b, c, t1); eager_dot = total(t1); });
+        lazy = medianUs("dot(b, c), fused", N, [&] { lazy_dot = hpc::dot(B, C); });
+        report("dot(b, c)", eager, lazy, 4, std::abs(eager_dot - lazy_dot) / std::abs(lazy_dot));
+        spdlog::info("(max diff is relative for the reductions; fused sums accumulate blocks in double)");
+    }
+    
+    // Parallel float dot product in whatever order OpenMP picks
+    static float ompDot(const float* x, const float* y, size_t n) {
+        float sum = 0.0f;
+        #ifdef _OPENMP
+        #pragma omp parallel for simd reduction(+:sum)
+        #endif
+        for (size_t i = 0; i < n; ++i) {
+            sum += x[i] * y[i];
+        }
+        return sum;
+    }
+    
+    // 14. Reproducible reductions (reproducible_reduce.h): dot(b, c) for
+    //     several thread counts and every ISA, against the plain OpenMP
+    //     reduction, whose result changes with the thread count
+    void reproducibleReductions() {
+        spdlog::info("\n=== Reproducible Dot Product (median times) ===");
+        spdlog::info("{:<22} {:<8} {:>7} {:>9} {:>16} {:>10}", "", "ISA", "threads", "μs", "result",
+                    "rel. error");
+        long double exact = 0.0L;
+        for (size_t i = 0; i < N; ++i) {
+            exact += static_cast<long double>(b[i]) * c[i];
+        }
+        #ifdef _OPENMP
+        const int saved_threads = omp_get_max_threads();
+        const std::vector<int> thread_counts = {1, 2, 4, 7};
+        #else
+        const std::vector<int> thread_counts = {1};
+        #endif
         
-        size_t unroll_factor = 4;
-        size_t unrolled_size = N - (N % unroll_factor);
+        auto bits = [](float value) {
+            uint32_t u;
+            std::memcpy(&u, &value, sizeof(u));
+            return u;
+        };
+        // Distinct results of each method, and its time at the last thread count
+        std::set<uint32_t> omp_results, plain_results, compensated_results;
+        double omp_us = 0.0, plain_us = 0.0, compensated_us = 0.0;
+        auto report = [&](const char* name, const char* isa, int threads, double us, float result) {
+            spdlog::info("{:<22} {:<8} {:>7} {:>9.0f} {:>16a} {:>10.2e}", name, isa, threads, us, result,
+                        static_cast<double>((result - exact) / exact));
+        };
+        
+        for (int threads : thread_counts) {
+            #ifdef _OPENMP
+            omp_set_num_threads(threads);
+            #endif
+            float result = 0.0f;
+            omp_us = medianUs("omp reduction, " + std::to_string(threads) + " threads", N,
+                              [&] { result = ompDot(b.data(), c.data(), N); });
+            omp_results.insert(bits(result));
+            report("omp reduction", "build", threads, omp_us, result);
+        }
         
-        // Manually unrolled loop
-        for (size_t i = 0; i < unrolled_size; i += unroll_factor) {
-            a[i] = b[i] + c[i];
-            a[i+1] = b[i+1] + c[i+1];
-            a[i+2] = b[i+2] + c[i+2];
-            a[i+3] = b[i+3] + c[i+3];
+        for (auto isa : {hpc::SimdIsa::Scalar, hpc::SimdIsa::SSE42, hpc::SimdIsa::AVX2,
+                         hpc::SimdIsa::AVX512, hpc::SimdIsa::NEON}) {
+            if (!hpc::simdIsaSupported(isa)) {
+                continue;
+            }
+            for (auto mode : {hpc::ReproMode::Plain, hpc::ReproMode::Compensated}) {
+                for (int threads : thread_counts) {
+                    #ifdef _OPENMP
+                    omp_set_num_threads(threads);
+                    #endif
+                    float result = 0.0f;
+                    const bool compensated = mode == hpc::ReproMode::Compensated;
+                    const double us = medianUs(std::string("reproducible dot, ") + hpc::reproModeName(mode) + ", " +
+                                                   hpc::simdIsaName(isa) + ", " + std::to_string(threads) + " threads",
+                                               N, [&] { result = hpc::reproducibleDot(isa, b.data(), c.data(), N, mode); });
+                    (compensated ? compensated_results : plain_results).insert(bits(result));
+                    if (isa == hpc::simdKernels().isa) {
+                        (compensated ? compensated_us : plain_us) = us;
+                    }
+                    report(compensated ? "reproducible, compens." : "reproducible", hpc::simdIsaName(isa),
+                           threads, us, result);
+                }
+            }
         }
+        #ifdef _OPENMP
+        omp_set_num_threads(saved_threads);
+        #endif
         
-        // Handle remaining elements
-        for (size_t i = unrolled_size; i < N; ++i) {
-            a[i] = b[i] + c[i];
+        spdlog::info("Distinct results: omp reduction {}, reproducible {}, compensated {}",
+                    omp_results.size(), plain_results.size(), compensated_results.size());
+        spdlog::info("Cost vs omp reduction ({} threads, {}): reproducible {:.2f}x, compensated {:.2f}x",
+                    thread_counts.back(), hpc::simdIsaName(hpc::simdKernels().isa), plain_us / omp_us,
+                    compensated_us / omp_us);
+    }
+    
+    // 15. Bulk copy / fill / scale (bulk_memory.h) against memcpy and
+    //     std::copy, from L1-resident buffers to ones several times the LLC
+    void bulkMemorySweep() {
+        const hpc::CacheTopology& topology = hpc::cacheTopology();
+        const size_t l1 = topology.dataCacheSize(1, 32 * 1024);
+        const size_t l2 = topology.dataCacheSize(2, 256 * 1024);
+        const size_t llc = topology.dataCacheSize(3, 8 * 1024 * 1024);
+        // Bytes per buffer: source + destination fill half of each cache
+        // level, and the DRAM row's destination alone is 4x the LLC
+        const std::pair<const char*, size_t> sizes[] = {
+            {"L1", l1 / 4}, {"L2", l2 / 4}, {"LLC", llc / 4}, {"DRAM", std::min(4 * llc, size_t(1) << 30)}};
+        
+        spdlog::info("\n=== Bulk Memory Bandwidth, GB/s (median times, read + write) ===");
+        spdlog::info("{:>5} {:>11} {:>8} {:>9} {:>8} {:>9} {:>9} {:>9} {:>10} {:>10} {:>10} {:>10} {:>10}", "level",
+                    "size", "memcpy", "std::copy", "regular", "streaming", "rep movsb", "auto", "auto picks",
+                    "fill reg.", "fill str.", "scale reg.", "scale str.");
+        
+        for (const auto& [level, bytes] : sizes) {
+            const size_t n = bytes / sizeof(float);
+            std::vector<float> src(n, 1.0f), dst(n, 0.0f);
+            const std::string suffix = ", " + std::to_string(bytes >> 10) + " KB";
+            
+            // GB/s of op, counting bytes_per_call
+            auto rate = [&](const std::string& name, double bytes_per_call, auto&& op) {
+                return bytes_per_call / (medianUs(name + suffix, n, op) * 1e3);
+            };
+            auto copy = [&](hpc::BulkStore store) {
+                return rate(std::string("bulk copy, ") + hpc::bulkStoreName(store), 2.0 * bytes,
+                            [&] { hpc::bulkCopy(dst.data(), src.data(), n * sizeof(float), store); });
+            };
+            auto fill = [&](hpc::BulkStore store) {
+                return rate(std::string("bulk fill, ") + hpc::bulkStoreName(store), bytes,
+                            [&] { hpc::bulkFill(dst.data(), 2.0f, n, store); });
+            };
+            auto scale = [&](hpc::BulkStore store) {
+                return rate(std::string("bulk scale, ") + hpc::bulkStoreName(store), 2.0 * bytes,
+                            [&] { hpc::bulkScale(dst.data(), src.data(), 0.5f, n, store); });
+            };
+            
+            const double memcpy_rate = rate("memcpy", 2.0 * bytes,
+                                            [&] { std::memcpy(dst.data(), src.data(), n * sizeof(float)); });
+            const double std_copy = rate("std::copy", 2.0 * bytes,
+                                         [&] { std::copy(src.begin(), src.end(), dst.begin()); });
+            const double regular = copy(hpc::BulkStore::Regular);
+            const double streaming = copy(hpc::BulkStore::Streaming);
+            const double rep_movsb = copy(hpc::BulkStore::RepMovsb);
+            const double automatic = copy(hpc::BulkStore::Auto);
+            const double fill_regular = fill(hpc::BulkStore::Regular);
+            const double fill_streaming = fill(hpc::BulkStore::Streaming);
+            const bool fill_ok = dst[n - 1] == 2.0f;
+            const double scale_regular = scale(hpc::BulkStore::Regular);
+            const double scale_streaming = scale(hpc::BulkStore::Streaming);
+            
+            spdlog::info("{:>5} {:>8} KB {:>8.1f} {:>9.1f} {:>8.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>10} {:>10.1f} "
+                        "{:>10.1f} {:>10.1f} {:>10.1f}",
+                        level, bytes >> 10, memcpy_rate, std_copy, regular, streaming, rep_movsb, automatic,
+                        hpc::bulkStoreName(hpc::bulkAutoStore(2 * bytes, true)), fill_regular, fill_streaming,
+                        scale_regular, scale_streaming);
+            if (!fill_ok || dst[n - 1] != 0.5f) {
+                spdlog::error("Bulk fill / scale of {} bytes gave wrong results", bytes);
+            }
+        }
+    }
+    
+    // 16. The add and dot kernels over double, float, int32, int16 and int8
+    //     at equal footprints, from L1-resident to DRAM-resident: where do
+    //     narrower element types stop paying off?
+    void elementTypeSweep() {
+        const hpc::CacheTopology& topology = hpc::cacheTopology();
+        const size_t l1 = topology.dataCacheSize(1, 32 * 1024);
+        const size_t l2 = topology.dataCacheSize(2, 256 * 1024);
+        const size_t llc = topology.dataCacheSize(3, 8 * 1024 * 1024);
+        const std::pair<const char*, size_t> footprints[] = {
+            {"L1", l1 / 2}, {"L2", l2 / 2}, {"LLC", llc / 2}, {"DRAM", std::min(4 * llc, size_t(1) << 30)}};
+        
+        spdlog::info("\n=== Element Type Sweep (median times; add reads b, c and writes a, dot reads b, c) ===");
+        spdlog::info("{:>5} {:>10} {:>6} {:>11} {:>12} {:>8} {:>8} {:>12} {:>8} {:>8}", "level", "footprint",
+                    "type", "elements", "add Gelem/s", "GB/s", "vs fp64", "dot Gelem/s", "GB/s", "vs fp64");
+        for (const auto& [level, footprint] : footprints) {
+            const SweepRates fp64 = elementTypeRow<double>(level, footprint, nullptr);
+            elementTypeRow<float>(level, footprint, &fp64);
+            elementTypeRow<int32_t>(level, footprint, &fp64);
+            elementTypeRow<int16_t>(level, footprint, &fp64);
+            elementTypeRow<int8_t>(level, footprint, &fp64);
+        }
+    }
+    
+    // One row of elementTypeSweep: a, b and c of T filling footprint bytes;
+    // fp64 is the row to compare with (none for fp64 itself)
+    template <typename T>
+    SweepRates elementTypeRow(const char* level, size_t footprint, const SweepRates* fp64) {
+        using Acc = typename SweepType<T>::Acc;
+        const size_t n = footprint / (3 * sizeof(T));
+        std::vector<T> ta(n), tb(n), tc(n);
+        std::mt19937 rng(42);
+        // Integers in [-8, 8] (eighths of them for fp32 / fp64): b + c fits
+        // every type and all products and partial sums are exact
+        std::uniform_int_distribution<int> dist(-8, 8);
+        for (size_t i = 0; i < n; ++i) {
+            tb[i] = static_cast<T>(std::is_integral_v<T> ? dist(rng) : dist(rng) / 8.0);
+            tc[i] = static_cast<T>(std::is_integral_v<T> ? dist(rng) : dist(rng) / 8.0);
         }
         
-        auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const std::string suffix = std::string(", ") + SweepType<T>::name + ", " + level;
+        Acc dot = 0;
+        const double add_us = medianUs("add" + suffix, n, [&] { simdAdd(tb.data(), tc.data(), ta.data(), n); });
+        const double dot_us = medianUs("dot" + suffix, n, [&] { dot = simdDot(tb.data(), tc.data(), n); });
+        const SweepRates rates{n / (add_us * 1e-6), n / (dot_us * 1e-6)};
+        
+        // Hence dot must equal the long double reference exactly (modulo
+        // 2^k in the unsigned integer accumulators)
+        long double reference = 0.0L;
+        for (size_t i = 0; i < n; ++i) {
+            reference += static_cast<long double>(tb[i]) * tc[i];
+        }
+        const Acc expected = std::is_integral_v<T> ? static_cast<Acc>(static_cast<int64_t>(reference))
+                                                   : static_cast<Acc>(reference);
+        if (ta[n - 1] != static_cast<T>(tb[n - 1] + tc[n - 1]) || dot != expected) {
+            spdlog::error("Element type sweep: wrong {} results at {} elements", SweepType<T>::name, n);
+        }
         
-        spdlog::info("Unrolled Loop Addition: {} μs", duration.count());
-        return duration.count();
+        const double gb = 1e-9 * sizeof(T);
+        spdlog::info("{:>5} {:>7} KB {:>6} {:>11} {:>12.2f} {:>8.1f} {:>7.2f}x {:>12.2f} {:>8.1f} {:>7.2f}x", level,
+                    footprint >> 10, SweepType<T>::name, n, rates.add * 1e-9, rates.add * 3 * gb,
+                    fp64 ? rates.add / fp64->add : 1.0, rates.dot * 1e-9, rates.dot * 2 * gb,
+                    fp64 ? rates.dot / fp64->dot : 1.0);
+        return rates;
     }
     
     void runAllBenchmarks() {
@@ -253,15 +692,19 @@ public:
         spdlog::info("ARM NEON support: Available");
         #endif
         
-        #ifdef __AVX2__
-        spdlog::info("AVX2 support: Available");
+        #ifdef __AVX512F__
+        spdlog::info("Compiled for: AVX-512");
+        #elif defined(__AVX2__)
+        spdlog::info("Compiled for: AVX2");
         #elif defined(__AVX__)
-        spdlog::info("AVX support: Available");
+        spdlog::info("Compiled for: AVX");
         #elif defined(__SSE4_2__)
-        spdlog::info("SSE4.2 support: Available");
+        spdlog::info("Compiled for: SSE4.2");
         #else
-        spdlog::info("SIMD support: Using compiler auto-vectorization");
+        spdlog::info("Compiled for: baseline ISA (compiler auto-vectorization)");
         #endif
+        spdlog::info("Runtime dispatch: {} (widest supported: {})",
+                    hpc::simdIsaName(hpc::simdKernels().isa), hpc::simdIsaName(hpc::detectSimdIsa()));
         
         std::vector<double> results;
         
@@ -276,6 +719,13 @@ public:
         results.push_back(memoryBandwidthTest());
         results.push_back(unrolledLoopAddition());
         
+        dispatchedKernels();
+        fastMathComparison();
+        lazyExpressions();
+        reproducibleReductions();
+        bulkMemorySweep();
+        elementTypeSweep();
+        
         // Calculate speedups
         spdlog::info("\n=== Performance Analysis ===");
         if (results[0] > 0) {
@@ -297,7 +747,7 @@ public:
         // Performance insights
         spdlog::info("\n=== Performance Insights ===");
         spdlog::info("• Scalar version provides baseline performance");
-        spdlog::info("• Auto-vectorization relies on compiler optimization (-O3 -march=native)");
+        spdlog::info("• Auto-vectorization relies on compiler optimization (-O3 and the build target)");
         spdlog::info("• OpenMP SIMD gives explicit vectorization hints");
         spdlog::info("• Parallel+SIMD combines multiple threads with vectorization");
         spdlog::info("• Memory bandwidth often limits performance more than computation");
@@ -305,12 +755,38 @@ public:
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
     try {
         spdlog::info("Starting SIMD/Vectorization Demo");
         
+        // --isa NAME: dispatch the explicit kernels to NAME instead of the
+        // widest ISA this host supports (scalar, sse4.2, avx2, avx512, neon)
+        for (int i = 1; i + 1 < argc; ++i) {
+            hpc::SimdIsa isa;
+            if (std::string(argv[i]) == "--isa") {
+                if (!hpc::parseSimdIsa(argv[i + 1], isa)) {
+                    throw std::invalid_argument(std::string("unknown ISA: ") + argv[i + 1]);
+                }
+                hpc::forceSimdIsa(isa);
+            }
+        }
+        
+        // --json PATH, --pin CPUS, --bench-time S, --bench-ci F: see
+        // benchmark.h. Pin before any worker thread exists.
+        const hpc::BenchConfig bench_config = hpc::parseBenchArgs(argc, argv);
+        hpc::configureBench(bench_config);
+        hpc::setBenchSink([](const hpc::BenchStats& stats) { spdlog::info("  [bench] {}", stats.summary()); });
+        
+        // Open the counters before any worker thread exists
+        spdlog::info("Performance counters: {}", hpc::perfCounters().describe());
+        hpc::setPerfSink([](const hpc::PerfReport& report) { spdlog::info("  [counters] {}", report.summary()); });
+        
         SIMDDemo demo;
         demo.runAllBenchmarks();
+        if (!bench_config.json_path.empty()) {
+            hpc::writeBenchJson(bench_config.json_path);
+            spdlog::info("Benchmark results written to {}", bench_config.json_path);
+        }
         
         spdlog::info("\nSIMD Demo completed successfully!");
         
@@ -0,0 +1,361 @@
+#pragma once
+
+// Structure-of-arrays containers generated from a record type.
+//
+// The field list is given as pointers to members of an ordinary struct:
+//
+//   struct Particle { float x, y, z, vx, vy, vz, mass; };
+//   hpc::SoA<Particle, &Particle::x, &Particle::y, ...>   particles(n);
+//   hpc::AoSoA<Particle, &Particle::x, &Particle::y, ...> tiled(n);
+//
+// Layouts (one 64-byte aligned allocation in both cases, from the
+// std::pmr::memory_resource passed to the constructor; by default
+// std::pmr::get_default_resource()):
+//   SoA    - one array per field, each starting on a cache line:
+//              x0 x1 x2 ... | y0 y1 y2 ... | ...
+//   AoSoA  - blocks of SOA_SIMD_LANES records, fields tiled inside a block:
+//              [x0..x15 | y0..y15 | ...] [x16..x31 | y16..y31 | ...] ...
+//            a block's fields sit in adjacent lines, so a kernel touching
+//            several fields streams from one region instead of one per field.
+//
+// Access:
+//   c.get<&Particle::x>(i), c.get<0>(i)   - field by member or index
+//   c[i].get<&Particle::x>(), Particle p = c[i], c[i] = p
+//                                         - proxy element
+//   c.fromAoS(records), c.toAoS(records)  - bulk conversion
+//   c.chunk(k).data<&Particle::x>()       - SOA_SIMD_LANES contiguous values
+//                                           of one field, for SIMD loops
+// Storage is padded to a whole number of chunks, so a chunk loop may always
+// process SOA_SIMD_LANES elements; lanes past size() are zero-initialized
+// padding and their results are ignored.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace hpc {
+
+// Elements per SIMD chunk (one vector register of floats)
+#if defined(__AVX512F__)
+constexpr size_t SOA_SIMD_LANES = 16;
+#elif defined(__AVX__)
+constexpr size_t SOA_SIMD_LANES = 8;
+#else
+constexpr size_t SOA_SIMD_LANES = 4;
+#endif
+
+namespace detail {
+
+constexpr size_t SOA_ALIGNMENT = 64;
+
+constexpr size_t roundUpSoA(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+template <typename MemberPointer>
+struct SoAMember;
+
+template <typename Record, typename Field>
+struct SoAMember<Field Record::*> {
+    using record = Record;
+    using type = Field;
+};
+
+struct SoADeallocator {
+    std::pmr::memory_resource* resource;
+    size_t bytes;
+    void operator()(unsigned char* p) const { resource->deallocate(p, bytes, SOA_ALIGNMENT); }
+};
+
+} // namespace detail
+
+// Tile == 0: plain SoA; Tile > 0: AoSoA with Tile records per block
+template <size_t Tile, typename Record, auto... Fields>
+class BasicSoA {
+    static_assert(sizeof...(Fields) > 0, "BasicSoA needs at least one field");
+    static_assert((std::is_same_v<typename detail::SoAMember<decltype(Fields)>::record, Record> && ...),
+                  "every field must be a member of Record");
+    static_assert((std::is_trivially_copyable_v<typename detail::SoAMember<decltype(Fields)>::type> && ...),
+                  "fields must be trivially copyable");
+
+public:
+    static constexpr size_t field_count = sizeof...(Fields);
+    static constexpr size_t chunk_size = Tile > 0 ? Tile : SOA_SIMD_LANES;
+
+    template <size_t I>
+    using FieldType = typename detail::SoAMember<
+        std::tuple_element_t<I, std::tuple<decltype(Fields)...>>>::type;
+
+    // Position of a field given as index or as pointer to member
+    template <auto Key>
+    static constexpr size_t fieldIndex() {
+        if constexpr (std::is_integral_v<decltype(Key)>) {
+            static_assert(static_cast<size_t>(Key) < field_count, "field index out of range");
+            return static_cast<size_t>(Key);
+        } else {
+            return memberIndex<Key, 0>();
+        }
+    }
+
+    // Proxy for element i: field access plus conversion to/from Record
+    template <typename Container>
+    class Ref {
+    public:
+        Ref(Container& container, size_t index) : container_(container), index_(index) {}
+
+        template <auto Key>
+        decltype(auto) get() const { return container_.template get<Key>(index_); }
+
+        operator Record() const { return container_.load(index_); }
+
+        template <typename C = Container, typename = std::enable_if_t<!std::is_const_v<C>>>
+        const Ref& operator=(const Record& record) const {
+            container_.store(index_, record);
+            return *this;
+        }
+
+        // c[i] = c[j] copies the element, not the proxy
+        const Ref& operator=(const Ref& other) const { return *this = static_cast<Record>(other); }
+
+    private:
+        Container& container_;
+        size_t index_;
+    };
+
+    // SIMD chunk k: elements [begin, begin + count), each field contiguous
+    template <typename Byte>
+    class Chunk {
+    public:
+        Chunk(Byte* base, size_t stride, size_t first, size_t begin, size_t count)
+            : base_(base), stride_(stride), first_(first), begin_(begin), count_(count) {}
+
+        size_t begin() const { return begin_; }
+        size_t count() const { return count_; }   // real elements, <= chunk_size
+
+        template <auto Key>
+        auto* data() const {
+            constexpr size_t I = fieldIndex<Key>();
+            using T = FieldType<I>;
+            using Ptr = std::conditional_t<std::is_const_v<Byte>, const T*, T*>;
+            return reinterpret_cast<Ptr>(base_ + offsetOf<I>() * stride_) + first_;
+        }
+
+    private:
+        Byte* base_;      // AoSoA: the block; SoA: the whole allocation
+        size_t stride_;   // AoSoA: 1 (offsets are within a block); SoA: capacity
+        size_t first_;    // AoSoA: 0; SoA: begin
+        size_t begin_;
+        size_t count_;
+    };
+
+    // resource must outlive the container
+    explicit BasicSoA(size_t n = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource) {
+        resize(n);
+    }
+
+    // Copies allocate from the default resource, as std::pmr containers do
+    BasicSoA(const BasicSoA& other) : BasicSoA(other.size_) {
+        std::memcpy(storage_.get(), other.storage_.get(), bytes_);
+    }
+    BasicSoA& operator=(const BasicSoA& other) {
+        if (this != &other) {
+            resize(other.size_);
+            std::memcpy(storage_.get(), other.storage_.get(), bytes_);
+        }
+        return *this;
+    }
+    BasicSoA(BasicSoA&&) noexcept = default;
+    BasicSoA& operator=(BasicSoA&&) noexcept = default;
+
+    // Discards the contents; every field is zero afterwards
+    void resize(size_t n) {
+        const size_t capacity = detail::roundUpSoA(std::max<size_t>(n, 1), capacityMultiple());
+        const size_t bytes = Tile > 0 ? capacity / Tile * blockBytes() : capacity * blockBytes();
+        void* p = resource_->allocate(bytes, detail::SOA_ALIGNMENT);
+        std::memset(p, 0, bytes);
+        storage_ = Storage(static_cast<unsigned char*>(p), detail::SoADeallocator{resource_, bytes});
+        size_ = n;
+        capacity_ = capacity;
+        bytes_ = bytes;
+    }
+
+    std::pmr::memory_resource* resource() const { return resource_; }
+
+    size_t size() const { return size_; }
+    size_t chunks() const { return (size_ + chunk_size - 1) / chunk_size; }
+    static constexpr bool tiled() { return Tile > 0; }
+
+    template <auto Key>
+    FieldType<fieldIndex<Key>()>& get(size_t i) {
+        return *fieldPointer<fieldIndex<Key>()>(storage_.get(), i);
+    }
+    template <auto Key>
+    const FieldType<fieldIndex<Key>()>& get(size_t i) const {
+        return *fieldPointer<fieldIndex<Key>()>(storage_.get(), i);
+    }
+
+    // Whole field array; only contiguous in the plain SoA layout
+    template <auto Key>
+    auto* data() {
+        static_assert(Tile == 0, "AoSoA fields are not contiguous; use chunk(k).data<Key>()");
+        return fieldPointer<fieldIndex<Key>()>(storage_.get(), 0);
+    }
+    template <auto Key>
+    auto* data() const {
+        static_assert(Tile == 0, "AoSoA fields are not contiguous; use chunk(k).data<Key>()");
+        return fieldPointer<fieldIndex<Key>()>(storage_.get(), 0);
+    }
+
+    Ref<BasicSoA> operator[](size_t i) { return Ref<BasicSoA>(*this, i); }
+    Ref<const BasicSoA> operator[](size_t i) const { return Ref<const BasicSoA>(*this, i); }
+
+    Record load(size_t i) const {
+        Record record{};
+        forEachField([&](auto I) { record.*member<I>() = get<I.value>(i); });
+        return record;
+    }
+
+    void store(size_t i, const Record& record) {
+        forEachField([&](auto I) { get<I.value>(i) = record.*member<I>(); });
+    }
+
+    // Bulk conversion; records holds size() elements. Walks one field at a
+    // time so each destination (or source) array is written sequentially.
+    void fromAoS(const Record* records) {
+        forEachField([&](auto I) {
+            constexpr auto field = member<I>();
+            for (size_t i = 0; i < size_; ++i) {
+                get<I.value>(i) = records[i].*field;
+            }
+        });
+    }
+
+    void toAoS(Record* records) const {
+        forEachField([&](auto I) {
+            constexpr auto field = member<I>();
+            for (size_t i = 0; i < size_; ++i) {
+                records[i].*field = get<I.value>(i);
+            }
+        });
+    }
+
+    Chunk<unsigned char> chunk(size_t k) { return makeChunk<unsigned char>(storage_.get(), k); }
+    Chunk<const unsigned char> chunk(size_t k) const {
+        return makeChunk<const unsigned char>(storage_.get(), k);
+    }
+
+    // fn(chunk) for every chunk in order
+    template <typename Fn>
+    void forEachChunk(Fn&& fn) {
+        for (size_t k = 0; k < chunks(); ++k) {
+            fn(chunk(k));
+        }
+    }
+
+private:
+    // Pointer to member of field I
+    template <size_t I>
+    static constexpr auto member() {
+        return std::get<I>(std::make_tuple(Fields...));
+    }
+
+    template <auto Key, size_t I>
+    static constexpr size_t memberIndex() {
+        static_assert(I < field_count, "member is not in the field list");
+        // Compared as template arguments: member pointers of different
+        // types cannot be compared with ==
+        using Candidate = std::tuple_element_t<I, std::tuple<decltype(Fields)...>>;
+        constexpr Candidate candidate = member<I>();
+        if constexpr (std::is_same_v<std::integral_constant<Candidate, candidate>,
+                                     std::integral_constant<decltype(Key), Key>>) {
+            return I;
+        } else {
+            return memberIndex<Key, I + 1>();
+        }
+    }
+
+    template <typename Fn, size_t... I>
+    static void forEachFieldImpl(Fn&& fn, std::index_sequence<I...>) {
+        (fn(std::integral_constant<size_t, I>{}), ...);
+    }
+    template <typename Fn>
+    static void forEachField(Fn&& fn) {
+        forEachFieldImpl(fn, std::make_index_sequence<field_count>{});
+    }
+
+    // AoSoA: bytes from block start to field I's tile (each tile starts on a
+    // cache line). SoA: bytes per element slot before field I, so field I's
+    // array starts at offsetOf<I>() * capacity.
+    template <size_t I>
+    static constexpr size_t offsetOf() {
+        size_t offset = 0;
+        if constexpr (I > 0) {
+            offset = offsetOf<I - 1>() + fieldStride<I - 1>();
+        }
+        return offset;
+    }
+    template <size_t I>
+    static constexpr size_t fieldStride() {
+        if constexpr (Tile > 0) {
+            return detail::roundUpSoA(Tile * sizeof(FieldType<I>), detail::SOA_ALIGNMENT);
+        } else {
+            return sizeof(FieldType<I>);
+        }
+    }
+    // AoSoA: bytes per block; SoA: bytes per element across all fields
+    static constexpr size_t blockBytes() {
+        return offsetOf<field_count - 1>() + fieldStride<field_count - 1>();
+    }
+
+    // SoA capacity is a multiple of 64 elements, so every field array
+    // (offsetOf * capacity bytes in) starts on a cache line whatever the
+    // field sizes; it is also a multiple of chunk_size
+    static constexpr size_t capacityMultiple() {
+        return Tile > 0 ? Tile : std::max(chunk_size, detail::SOA_ALIGNMENT);
+    }
+
+    template <size_t I, typename Byte>
+    auto* fieldPointer(Byte* base, size_t i) const {
+        using T = FieldType<I>;
+        using Ptr = std::conditional_t<std::is_const_v<Byte>, const T*, T*>;
+        if constexpr (Tile > 0) {
+            Byte* block = base + (i / Tile) * blockBytes();
+            return reinterpret_cast<Ptr>(block + offsetOf<I>()) + i % Tile;
+        } else {
+            return reinterpret_cast<Ptr>(base + offsetOf<I>() * capacity_) + i;
+        }
+    }
+
+    template <typename Byte>
+    Chunk<Byte> makeChunk(Byte* base, size_t k) const {
+        size_t begin = k * chunk_size;
+        size_t count = begin < size_ ? std::min(chunk_size, size_ - begin) : 0;
+        if constexpr (Tile > 0) {
+            return Chunk<Byte>(base + k * blockBytes(), 1, 0, begin, count);
+        } else {
+            return Chunk<Byte>(base, capacity_, begin, begin, count);
+        }
+    }
+
+    using Storage = std::unique_ptr<unsigned char[], detail::SoADeallocator>;
+
+    std::pmr::memory_resource* resource_;
+    Storage storage_{nullptr, detail::SoADeallocator{nullptr, 0}};
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    size_t bytes_ = 0;
+};
+
+template <typename Record, auto... Fields>
+using SoA = BasicSoA<0, Record, Fields...>;
+
+template <typename Record, auto... Fields>
+using AoSoA = BasicSoA<SOA_SIMD_LANES, Record, Fields...>;
+
+} // namespace hpc
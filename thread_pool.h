@@ -0,0 +1,266 @@
+#pragma once
+
+// Persistent worker threads for fork-join kernels and one-off tasks.
+//
+// Creating and joining std::threads costs tens of microseconds per thread,
+// more than a reduction over a few MB takes, so the workers here are started
+// once and reused:
+//
+//   ThreadPool::submit(f, args...)   - queues f(args...) for any worker and
+//                                      returns a std::future of its result
+//                                      (exceptions arrive through the future).
+//   ThreadPool::parallelFor(b, e, body)
+//                                    - splits [b, e) into one contiguous chunk
+//                                      per worker, calls body(lo, hi, worker)
+//                                      on each and returns once all are done;
+//                                      the first exception a chunk throws is
+//                                      rethrown in the caller.
+//   CompletionBarrier                - the count-down parallelFor waits on:
+//                                      spins for a while, then parks on a
+//                                      condition variable.
+//
+// Idle workers likewise spin before parking, so back-to-back parallelFor
+// calls wake them without a system call. Spinning only pays while every
+// spinner has a core of its own: the default spin limit is 0 (park at once)
+// when the workers plus the caller outnumber the hardware threads.
+//
+// parallelFor calls from different threads are serialized. A parallelFor
+// waits for workers that are still busy with submitted tasks, and must not
+// be called from inside a task or chunk of the same pool.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace hpc {
+
+namespace detail {
+
+// Busy-wait hint: lets the sibling hyperthread run and saves power
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace detail
+
+// Default number of pool workers: one per hardware thread
+inline size_t defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Default spin limit for a pool of threads workers, see the top of this file
+inline unsigned defaultSpinLimit(size_t threads) {
+    return threads < std::thread::hardware_concurrency() ? 1u << 14 : 0;
+}
+
+// Waits until reset(count) has been followed by count arrive() calls
+class CompletionBarrier {
+public:
+    explicit CompletionBarrier(unsigned spin_limit) : spin_limit_(spin_limit) {}
+
+    // Before any participant can arrive
+    void reset(size_t count) { remaining_.store(count, std::memory_order_relaxed); }
+
+    void arrive() {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // Taking the lock orders this notify after a parked waiter's
+            // predicate check, so the wake-up cannot be lost
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            parked_.notify_one();
+        }
+    }
+
+    // Spins for up to spin_limit pauses, then parks
+    void wait() {
+        for (unsigned spin = 0; spin < spin_limit_ && !done(); ++spin) {
+            detail::cpuRelax();
+        }
+        if (!done()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            parked_.wait(lock, [this] { return done(); });
+        }
+    }
+
+private:
+    bool done() const { return remaining_.load(std::memory_order_acquire) == 0; }
+
+    const unsigned spin_limit_;
+    std::atomic<size_t> remaining_{0};
+    std::mutex mutex_;
+    std::condition_variable parked_;
+};
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = defaultThreadCount())
+        : ThreadPool(threads, defaultSpinLimit(threads)) {}
+
+    ThreadPool(size_t threads, unsigned spin_limit) : spin_limit_(spin_limit), done_(spin_limit) {
+        threads = std::max<size_t>(threads, 1);
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs the tasks still queued, then joins the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true, std::memory_order_relaxed);
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    template <typename F, typename... Args>
+    auto submit(F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+        using Result = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+            [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(std::move(f), std::move(args));
+            });
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([task] { (*task)(); });
+            queued_.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake_.notify_one();
+        return result;
+    }
+
+    // body(lo, hi, worker) for size() contiguous chunks of [begin, end),
+    // chunk sizes differing by at most one; empty chunks are skipped
+    template <typename Body>
+    void parallelFor(size_t begin, size_t end, Body&& body) {
+        if (begin >= end) {
+            return;
+        }
+        const size_t chunks = size();
+        const size_t base = (end - begin) / chunks;
+        const size_t extra = (end - begin) % chunks;
+        auto chunk = [&](size_t worker) {
+            const size_t lo = begin + worker * base + std::min(worker, extra);
+            const size_t hi = lo + base + (worker < extra ? 1 : 0);
+            if (lo < hi) {
+                body(lo, hi, worker);
+            }
+        };
+
+        std::lock_guard<std::mutex> serial(for_mutex_);
+        error_ = nullptr;
+        done_.reset(chunks);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = [](const void* context, size_t worker) {
+                (*static_cast<const decltype(chunk)*>(context))(worker);
+            };
+            job_context_ = &chunk;
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+        wake_.notify_all();
+        done_.wait();
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    bool hasWork(uint64_t seen) const {
+        return generation_.load(std::memory_order_acquire) != seen ||
+               queued_.load(std::memory_order_relaxed) != 0 || stop_.load(std::memory_order_relaxed);
+    }
+
+    void workerLoop(size_t worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            for (unsigned spin = 0; spin < spin_limit_ && !hasWork(seen); ++spin) {
+                detail::cpuRelax();
+            }
+            // A new parallelFor generation needs no lock: job_ was published
+            // before it. Tasks, stopping and parking go through the mutex.
+            if (generation_.load(std::memory_order_acquire) == seen) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    wake_.wait(lock, [&] { return hasWork(seen); });
+                    if (generation_.load(std::memory_order_relaxed) == seen) {
+                        if (tasks_.empty()) {
+                            return;
+                        }
+                        task = std::move(tasks_.front());
+                        tasks_.pop_front();
+                        queued_.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                }
+                if (task) {
+                    task();
+                    continue;
+                }
+            }
+            // The caller waits for every chunk before the next generation,
+            // so this is exactly the one after seen
+            seen = generation_.load(std::memory_order_acquire);
+            try {
+                job_(job_context_, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            done_.arrive();
+        }
+    }
+
+    const unsigned spin_limit_;
+    std::vector<std::thread> workers_;
+
+    // Task queue; mutex_ also guards publishing a parallelFor and stopping
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> tasks_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<bool> stop_{false};
+
+    // Current parallelFor: job_(job_context_, worker) runs one chunk
+    std::mutex for_mutex_;
+    std::atomic<uint64_t> generation_{0};
+    void (*job_)(const void*, size_t) = nullptr;
+    const void* job_context_ = nullptr;
+    CompletionBarrier done_;
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+}  // namespace hpc
@@ -0,0 +1,257 @@
+#pragma once
+
+// SIMD tile transpose engine.
+//
+// Blocks of block x block elements are walked so both matrices stay in
+// cache; inside a block, TILE x TILE tiles are transposed in registers:
+// 8x8 with AVX (unpack/shuffle/permute2f128), 4x4 with SSE or NEON. Edges
+// that do not fill a tile fall back to scalar copies.
+//
+// Store modes:
+//   Regular    - ordinary stores, destination is left in cache
+//   Streaming  - non-temporal stores + sfence; for matrices larger than the
+//                LLC, where writing through the cache would only evict the
+//                source. Tiles are walked so consecutive tiles complete whole
+//                destination cache lines in the write-combining buffers.
+//   Auto       - Streaming when source + destination exceed the LLC
+//
+// transposeInPlace() handles square matrices without a second N² buffer by
+// swapping mirrored tile pairs through a TILE x TILE scratch tile.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "cache_topology.h"
+
+namespace hpc {
+
+#if defined(__AVX__)
+constexpr int TRANSPOSE_TILE = 8;
+constexpr const char* TRANSPOSE_KERNEL_NAME = "AVX 8x8";
+#elif defined(__SSE__)
+constexpr int TRANSPOSE_TILE = 4;
+constexpr const char* TRANSPOSE_KERNEL_NAME = "SSE 4x4";
+#elif defined(__ARM_NEON)
+constexpr int TRANSPOSE_TILE = 4;
+constexpr const char* TRANSPOSE_KERNEL_NAME = "NEON 4x4";
+#else
+constexpr int TRANSPOSE_TILE = 4;
+constexpr const char* TRANSPOSE_KERNEL_NAME = "scalar 4x4";
+#endif
+
+enum class TransposeStore { Regular, Streaming, Auto };
+
+inline const char* transposeStoreName(TransposeStore store) {
+    switch (store) {
+        case TransposeStore::Regular: return "regular";
+        case TransposeStore::Streaming: return "streaming";
+        case TransposeStore::Auto: return "auto";
+    }
+    return "unknown";
+}
+
+namespace detail {
+
+// dst (TILE x TILE, leading dimension ldd) = transpose of src (lds).
+// With stream set, dst rows must be TILE * sizeof(float) aligned.
+inline void transposeTile(const float* src, int lds, float* dst, int ldd, bool stream) {
+#if defined(__AVX__)
+    __m256 r0 = _mm256_loadu_ps(src + 0 * static_cast<size_t>(lds));
+    __m256 r1 = _mm256_loadu_ps(src + 1 * static_cast<size_t>(lds));
+    __m256 r2 = _mm256_loadu_ps(src + 2 * static_cast<size_t>(lds));
+    __m256 r3 = _mm256_loadu_ps(src + 3 * static_cast<size_t>(lds));
+    __m256 r4 = _mm256_loadu_ps(src + 4 * static_cast<size_t>(lds));
+    __m256 r5 = _mm256_loadu_ps(src + 5 * static_cast<size_t>(lds));
+    __m256 r6 = _mm256_loadu_ps(src + 6 * static_cast<size_t>(lds));
+    __m256 r7 = _mm256_loadu_ps(src + 7 * static_cast<size_t>(lds));
+
+    // Interleave pairs of rows, then pairs of pairs, then swap 128-bit halves
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    __m256 out[8] = {
+        _mm256_permute2f128_ps(s0, s4, 0x20),
+        _mm256_permute2f128_ps(s1, s5, 0x20),
+        _mm256_permute2f128_ps(s2, s6, 0x20),
+        _mm256_permute2f128_ps(s3, s7, 0x20),
+        _mm256_permute2f128_ps(s0, s4, 0x31),
+        _mm256_permute2f128_ps(s1, s5, 0x31),
+        _mm256_permute2f128_ps(s2, s6, 0x31),
+        _mm256_permute2f128_ps(s3, s7, 0x31),
+    };
+    for (int i = 0; i < 8; ++i) {
+        float* row = dst + static_cast<size_t>(i) * ldd;
+        if (stream) {
+            _mm256_stream_ps(row, out[i]);
+        } else {
+            _mm256_storeu_ps(row, out[i]);
+        }
+    }
+#elif defined(__SSE__)
+    __m128 r0 = _mm_loadu_ps(src + 0 * static_cast<size_t>(lds));
+    __m128 r1 = _mm_loadu_ps(src + 1 * static_cast<size_t>(lds));
+    __m128 r2 = _mm_loadu_ps(src + 2 * static_cast<size_t>(lds));
+    __m128 r3 = _mm_loadu_ps(src + 3 * static_cast<size_t>(lds));
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    __m128 out[4] = {r0, r1, r2, r3};
+    for (int i = 0; i < 4; ++i) {
+        float* row = dst + static_cast<size_t>(i) * ldd;
+        if (stream) {
+            _mm_stream_ps(row, out[i]);
+        } else {
+            _mm_storeu_ps(row, out[i]);
+        }
+    }
+#elif defined(__ARM_NEON)
+    (void)stream;  // NEON has no non-temporal store intrinsic
+    float32x4_t r0 = vld1q_f32(src + 0 * static_cast<size_t>(lds));
+    float32x4_t r1 = vld1q_f32(src + 1 * static_cast<size_t>(lds));
+    float32x4_t r2 = vld1q_f32(src + 2 * static_cast<size_t>(lds));
+    float32x4_t r3 = vld1q_f32(src + 3 * static_cast<size_t>(lds));
+    float32x4x2_t p01 = vtrnq_f32(r0, r1);
+    float32x4x2_t p23 = vtrnq_f32(r2, r3);
+    vst1q_f32(dst + 0 * static_cast<size_t>(ldd),
+              vcombine_f32(vget_low_f32(p01.val[0]), vget_low_f32(p23.val[0])));
+    vst1q_f32(dst + 1 * static_cast<size_t>(ldd),
+              vcombine_f32(vget_low_f32(p01.val[1]), vget_low_f32(p23.val[1])));
+    vst1q_f32(dst + 2 * static_cast<size_t>(ldd),
+              vcombine_f32(vget_high_f32(p01.val[0]), vget_high_f32(p23.val[0])));
+    vst1q_f32(dst + 3 * static_cast<size_t>(ldd),
+              vcombine_f32(vget_high_f32(p01.val[1]), vget_high_f32(p23.val[1])));
+#else
+    (void)stream;
+    for (int i = 0; i < TRANSPOSE_TILE; ++i) {
+        for (int j = 0; j < TRANSPOSE_TILE; ++j) {
+            dst[static_cast<size_t>(j) * ldd + i] = src[static_cast<size_t>(i) * lds + j];
+        }
+    }
+#endif
+}
+
+inline void transposeScalar(const float* src, int lds, float* dst, int ldd, int rows, int cols) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            dst[static_cast<size_t>(j) * ldd + i] = src[static_cast<size_t>(i) * lds + j];
+        }
+    }
+}
+
+inline void streamFence() {
+#if defined(__SSE__)
+    _mm_sfence();
+#endif
+}
+
+} // namespace detail
+
+// B (cols x rows, leading dimension ldb) = transpose of A (rows x cols, lda)
+inline void transpose(const float* A, int lda, float* B, int ldb, int rows, int cols,
+                      int block = 64, TransposeStore store = TransposeStore::Auto) {
+    constexpr int T = TRANSPOSE_TILE;
+    constexpr uintptr_t STREAM_ALIGN = T * sizeof(float);
+
+    bool stream = store == TransposeStore::Streaming;
+    if (store == TransposeStore::Auto) {
+        size_t bytes = 2 * static_cast<size_t>(rows) * cols * sizeof(float);
+        stream = bytes > cacheTopology().dataCacheSize(3, 8 * 1024 * 1024);
+    }
+    block = std::max(T, block / T * T);
+
+    for (int ii = 0; ii < rows; ii += block) {
+        const int i_max = std::min(ii + block, rows);
+        const int i_full = ii + (i_max - ii) / T * T;
+        for (int jj = 0; jj < cols; jj += block) {
+            const int j_max = std::min(jj + block, cols);
+            const int j_full = jj + (j_max - jj) / T * T;
+            // j outer, i inner: successive tiles continue the same destination
+            // rows, which lets streaming stores fill whole lines
+            for (int j = jj; j < j_full; j += T) {
+                for (int i = ii; i < i_full; i += T) {
+                    float* dst = B + static_cast<size_t>(j) * ldb + i;
+                    bool aligned = reinterpret_cast<uintptr_t>(dst) % STREAM_ALIGN == 0 &&
+                                   (static_cast<size_t>(ldb) * sizeof(float)) % STREAM_ALIGN == 0;
+                    detail::transposeTile(A + static_cast<size_t>(i) * lda + j, lda, dst, ldb,
+                                          stream && aligned);
+                }
+            }
+            // Ragged right columns and bottom rows of this block
+            detail::transposeScalar(A + static_cast<size_t>(ii) * lda + j_full, lda,
+                                    B + static_cast<size_t>(j_full) * ldb + ii, ldb,
+                                    i_max - ii, j_max - j_full);
+            detail::transposeScalar(A + static_cast<size_t>(i_full) * lda + jj, lda,
+                                    B + static_cast<size_t>(jj) * ldb + i_full, ldb,
+                                    i_max - i_full, j_full - jj);
+        }
+    }
+    if (stream) {
+        detail::streamFence();
+    }
+}
+
+// Transpose the n x n matrix A (leading dimension lda) in place
+inline void transposeInPlace(float* A, int lda, int n, int block = 64) {
+    constexpr int T = TRANSPOSE_TILE;
+    alignas(64) float scratch[T * T];
+    alignas(64) float diagonal[T * T];
+    block = std::max(T, block / T * T);
+    const int n_full = n / T * T;
+
+    for (int ii = 0; ii < n_full; ii += block) {
+        const int i_max = std::min(ii + block, n_full);
+        for (int jj = ii; jj < n_full; jj += block) {
+            const int j_max = std::min(jj + block, n_full);
+            for (int i = ii; i < i_max; i += T) {
+                // Only tiles on or above the diagonal; each handles its mirror
+                for (int j = std::max(jj, i); j < j_max; j += T) {
+                    float* upper = A + static_cast<size_t>(i) * lda + j;
+                    if (i == j) {
+                        detail::transposeTile(upper, lda, diagonal, T, false);
+                        for (int r = 0; r < T; ++r) {
+                            std::copy_n(diagonal + r * T, T, upper + static_cast<size_t>(r) * lda);
+                        }
+                        continue;
+                    }
+                    float* lower = A + static_cast<size_t>(j) * lda + i;
+                    detail::transposeTile(lower, lda, scratch, T, false);
+                    detail::transposeTile(upper, lda, lower, lda, false);
+                    for (int r = 0; r < T; ++r) {
+                        std::copy_n(scratch + r * T, T, upper + static_cast<size_t>(r) * lda);
+                    }
+                }
+            }
+        }
+    }
+
+    // Rows/columns past the last full tile: swap element pairs
+    for (int i = 0; i < n; ++i) {
+        for (int j = std::max(i + 1, n_full); j < n; ++j) {
+            std::swap(A[static_cast<size_t>(i) * lda + j], A[static_cast<size_t>(j) * lda + i]);
+        }
+    }
+}
+
+} // namespace hpc